@@ -0,0 +1,984 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "synthetic.h"
+#include "runner.h"
+
+using namespace std;
+
+// benchmark: ejecuta cada filtro en cada backend sobre una matriz de imágenes y números
+// de hilos/procesos, con corridas de calentamiento y varias muestras por caso.
+// Los tiempos salen del JSON de timing.h (FILTER_TIMING_JSON), así se compara sólo la
+// fase de cómputo y no la lectura ni la escritura del archivo.
+//
+// Uso: ./benchmark [opciones]
+//   --serial BIN --omp BIN --pthreads BIN --mpi BIN   ejecutables de cada backend
+//   --mpirun CMD                                      lanzador MPI (por defecto "mpirun")
+//   --backends serial,omp,pthreads,mpi                backends a medir
+//   --filters blur,laplace,sharpen                    filtros a medir
+//   --inputs puj.ppm,puj.pgm                          imágenes de entrada
+//   --synthetic 3840x2160x3,8kx1                      imágenes sintéticas TAMAÑOxCANALES
+//                                                     (ANCHOxALTO, 8k, 16k o gigapixel)
+//   --workers 1,2,4                                   hilos (omp) o procesos (mpi)
+//   --warmup N --repeat N                             corridas descartadas y muestras
+//   --csv archivo --json archivo                      salidas para procesar los datos
+//   --compare archivo.csv                             CSV de una corrida anterior (por ejemplo
+//                                                     sin PGO): agrega la mejora de cómputo y de
+//                                                     tiempo total respecto a ella
+//
+// Modo de escalabilidad (barre hilos o procesos de omp, pthreads y mpi):
+//   --scaling strong|weak         strong: imagen fija (la primera entrada);
+//                                 weak: imagen sintética que crece con los workers
+//   --max-workers N               mayor número de workers del barrido (1, 2, 4, ..., N)
+//   --weak-base ANCHOxALTOxCANALES  imagen por worker en weak scaling (el alto se multiplica)
+//
+// Modo roofline:
+//   --roofline                    mide un techo de ancho de banda (tipo STREAM triad) y uno de
+//                                 FLOP/s, y ubica cada filtro y backend respecto a ellos
+//
+// Modo de ajuste de OpenMP (planificación de filter_omp, ver Planificacion en filter_omp.cpp):
+//   --omp-tune                    prueba cada FILTER_OMP_SCHEDULE x FILTER_OMP_CHUNK x
+//                                 FILTER_OMP_BIND con --max-workers hilos sobre la primera
+//                                 entrada y recomienda la de menor tiempo total
+//   --omp-schedules tasks,static,dynamic,guided
+//   --omp-chunks 4,16,32,128      filas por banda
+//   --omp-binds default,close,spread
+//
+// Modo de E/S por bandas (filter --stream, ver streamio.h):
+//   --stream-io                   corre el primer filtro en modo --stream sobre cada entrada con
+//                                 cada FILTER_STREAM_IO, sacando la entrada del page cache antes
+//                                 de cada corrida, y muestra cuánto de la entrada y de la salida
+//                                 quedó en caché al terminar. Las sintéticas se generan en
+//                                 binario (el modo stream sólo lee P5/P6)
+//   --stream-modes buffered,mmap,direct
+//   --stream-rows 64              filas por banda (FILTER_STREAM_ROWS)
+
+struct Config {
+    Backends bins;
+    vector<string> backends = {"serial", "omp", "pthreads", "mpi"};
+    vector<string> filters = {"blur", "laplace", "sharpen"};
+    vector<string> inputs = {"puj.ppm", "puj.pgm"};
+    vector<string> synthetic;
+    vector<int> workers = {1, 2, 4};
+    int warmup = 1;
+    int repeat = 5;
+    string csvPath;
+    string jsonPath;
+    string comparePath;
+    string scaling;
+    int maxWorkers = max(4, (int)thread::hardware_concurrency());
+    string weakBase = "1920x600x3";
+    bool roofline = false;
+    bool ompTune = false;
+    vector<string> ompSchedules = {"tasks", "static", "dynamic", "guided"};
+    vector<string> ompChunks = {"4", "16", "32", "128"};
+    vector<string> ompBinds = {"default", "close", "spread"};
+    bool streamIo = false;
+    vector<string> streamModes = {"buffered", "mmap", "direct"};
+    string streamRows = "64";
+};
+
+// Entrada: archivo ya listo para pasarle a los backends
+struct Entrada {
+    string path;
+    string nombre;
+    int width, height, channels;
+};
+
+struct Resultado {
+    string backend, filter, input;
+    int width, height, channels, workers;
+    vector<long long> computeNs, wallNs;
+    bool ok;
+    int reportedWorkers;  // los que el backend dice haber usado realmente
+};
+
+// leerCabecera: lee tipo y dimensiones de un PNM sin cargar los píxeles
+bool leerCabecera(const string& path, int& width, int& height, int& channels) {
+    ifstream in(path.c_str(), ios::binary);
+    if (!in.is_open()) return false;
+    string magic;
+    in >> magic >> width >> height;
+    channels = (magic == "P3" || magic == "P6") ? 3 : 1;
+    return (bool)in;
+}
+
+// generarSintetica: imagen de ruido con semilla fija (synthetic.h), para que todas las
+// corridas midan exactamente los mismos datos; ASCII salvo que se pida binaria
+bool generarSintetica(const string& path, int width, int height, int channels, bool binaria = false) {
+    SyntheticSpec spec;
+    spec.width = width;
+    spec.height = height;
+    spec.channels = channels;
+    spec.binary = binaria;
+    return writeSynthetic(path, spec);
+}
+
+// correr: ejecuta una vez el backend y devuelve el cómputo y el tiempo de pared en ns,
+// junto con el número de workers que el backend reporta en su JSON
+bool correr(const Config& cfg, const string& dir, const string& backend, const string& filter,
+            const Entrada& entrada, int workers, long long& computeNs, long long& wallNs,
+            int& reportedWorkers) {
+    Corrida corrida;
+    if (!ejecutarBackend(cfg.bins, dir, backend, filter, entrada.path, entrada.channels, workers, corrida)) {
+        return false;
+    }
+    computeNs = corrida.computeNs;
+    wallNs = corrida.wallNs;
+    reportedWorkers = corrida.reportedWorkers;
+    return true;
+}
+
+// medir: corridas de calentamiento y luego cfg.repeat muestras de un caso
+Resultado medir(const Config& cfg, const string& dir, const string& backend, const string& filter,
+                const Entrada& e, int w) {
+    Resultado r = {backend, filter, e.nombre, e.width, e.height, e.channels, w, {}, {}, true, w};
+    for (int i = 0; i < cfg.warmup + cfg.repeat && r.ok; i++) {
+        long long computeNs = 0, wallNs = 0;
+        r.ok = correr(cfg, dir, backend, filter, e, w, computeNs, wallNs, r.reportedWorkers);
+        if (i >= cfg.warmup) {
+            r.computeNs.push_back(computeNs);
+            r.wallNs.push_back(wallNs);
+        }
+    }
+    if (!r.ok) cerr << "Falló " << backend << " " << filter << " " << e.nombre << " w=" << w << "\n";
+    return r;
+}
+
+// prepararSintetica: interpreta TAMAÑO[xCANALES] (ANCHOxALTO, 8k, 16k o gigapixel) y
+// genera la imagen en dir
+bool prepararSintetica(const string& dir, const string& spec, Entrada& e, bool binaria = false) {
+    e.channels = 3;
+    string tamano = spec, resto;
+    const char* nombres[] = {"gigapixel", "16k", "8k"};
+    for (const char* nombre : nombres) {
+        if (spec.compare(0, strlen(nombre), nombre) == 0) {
+            tamano = nombre;
+            resto = spec.substr(strlen(nombre));
+            break;
+        }
+    }
+    if (tamano == spec) {
+        vector<string> partes = separar(spec, 'x');
+        if (partes.size() == 3) {
+            tamano = partes[0] + "x" + partes[1];
+            resto = "x" + partes[2];
+        }
+    }
+    if (!resto.empty()) e.channels = (resto[0] == 'x') ? atoi(resto.c_str() + 1) : 0;
+
+    long long w = 0, h = 0;
+    if (!parseSize(tamano, w, h) || w > INT_MAX || h > INT_MAX || (e.channels != 1 && e.channels != 3)) {
+        cerr << "Tamaño sintético inválido: " << spec << "\n";
+        return false;
+    }
+    e.width = (int)w;
+    e.height = (int)h;
+    e.nombre = "synthetic_" + to_string(e.width) + "x" + to_string(e.height) + "x" + to_string(e.channels);
+    e.path = dir + "/" + e.nombre + (e.channels == 3 ? ".ppm" : ".pgm");
+    cerr << "Generando " << e.nombre << "...\n";
+    if (!generarSintetica(e.path, e.width, e.height, e.channels, binaria)) {
+        cerr << "No se pudo generar " << spec << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool leerArgumentos(int argc, char* argv[], Config& cfg) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--roofline") {
+            cfg.roofline = true;
+            continue;
+        }
+        if (arg == "--omp-tune") {
+            cfg.ompTune = true;
+            continue;
+        }
+        if (arg == "--stream-io") {
+            cfg.streamIo = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Falta el valor de " << arg << "\n";
+            return false;
+        }
+        string valor = argv[++i];
+        if (cfg.bins.leerOpcion(arg, valor)) continue;
+        if (arg == "--backends") cfg.backends = separar(valor, ',');
+        else if (arg == "--filters") cfg.filters = separar(valor, ',');
+        else if (arg == "--inputs") cfg.inputs = separar(valor, ',');
+        else if (arg == "--synthetic") cfg.synthetic = separar(valor, ',');
+        else if (arg == "--workers") {
+            cfg.workers.clear();
+            for (const string& w : separar(valor, ',')) cfg.workers.push_back(max(1, atoi(w.c_str())));
+        }
+        else if (arg == "--warmup") cfg.warmup = max(0, atoi(valor.c_str()));
+        else if (arg == "--repeat") cfg.repeat = max(1, atoi(valor.c_str()));
+        else if (arg == "--csv") cfg.csvPath = valor;
+        else if (arg == "--json") cfg.jsonPath = valor;
+        else if (arg == "--compare") cfg.comparePath = valor;
+        else if (arg == "--scaling") cfg.scaling = valor;
+        else if (arg == "--max-workers") cfg.maxWorkers = max(1, atoi(valor.c_str()));
+        else if (arg == "--weak-base") cfg.weakBase = valor;
+        else if (arg == "--omp-schedules") cfg.ompSchedules = separar(valor, ',');
+        else if (arg == "--omp-chunks") cfg.ompChunks = separar(valor, ',');
+        else if (arg == "--omp-binds") cfg.ompBinds = separar(valor, ',');
+        else if (arg == "--stream-modes") cfg.streamModes = separar(valor, ',');
+        else if (arg == "--stream-rows") cfg.streamRows = valor;
+        else {
+            cerr << "Opción desconocida: " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Comparacion: medianas de cómputo y de tiempo total de una corrida anterior
+struct Comparacion {
+    double computeNs, wallNs;
+};
+
+// leerComparacion: lee el CSV del modo matriz y lo indexa por backend/filter/input/workers.
+// Las columnas se buscan por nombre para aceptar CSV de versiones anteriores.
+map<string, Comparacion> leerComparacion(const string& path) {
+    map<string, Comparacion> base;
+    ifstream in(path.c_str());
+    string linea;
+    if (!getline(in, linea)) {
+        cerr << "No se pudo leer la comparación: " << path << "\n";
+        return base;
+    }
+    vector<string> columnas = separar(linea, ',');
+    auto indice = [&](const string& nombre) {
+        return (int)(find(columnas.begin(), columnas.end(), nombre) - columnas.begin());
+    };
+    int iBackend = indice("backend"), iFilter = indice("filter"), iInput = indice("input"),
+        iWorkers = indice("workers"), iCompute = indice("compute_median_ns"), iWall = indice("wall_median_ns");
+    int n = (int)columnas.size();
+    if (iBackend == n || iFilter == n || iInput == n || iWorkers == n || iCompute == n || iWall == n) {
+        cerr << "El CSV " << path << " no es del modo matriz\n";
+        return base;
+    }
+    while (getline(in, linea)) {
+        vector<string> campos = separar(linea, ',');
+        if ((int)campos.size() < n) continue;
+        Comparacion c = {atof(campos[iCompute].c_str()), atof(campos[iWall].c_str())};
+        base[campos[iBackend] + "/" + campos[iFilter] + "/" + campos[iInput] + "/" + campos[iWorkers]] = c;
+    }
+    return base;
+}
+
+// escribirSalidas: guarda los textos CSV y JSON en las rutas pedidas
+void escribirSalidas(const Config& cfg, const string& csv, const string& json) {
+    if (!cfg.csvPath.empty()) {
+        ofstream out(cfg.csvPath.c_str());
+        out << csv;
+    }
+    if (!cfg.jsonPath.empty()) {
+        ofstream out(cfg.jsonPath.c_str());
+        out << json;
+    }
+}
+
+// estudioEscalabilidad: barre 1, 2, 4, ..., maxWorkers para omp, pthreads y mpi.
+// En strong scaling la imagen es fija y speedup = T(1) / T(p); en weak scaling la imagen
+// crece con p, así que la eficiencia es T(1) / T(p) y el speedup escalado p * T(1) / T(p).
+// La fracción serial de Karp–Flatt, e = (1/S - 1/p) / (1 - 1/p), sólo aplica a strong:
+// si se mantiene constante al crecer p el límite es la parte serial del programa; si
+// crece, el límite es el costo de coordinar a los workers.
+int estudioEscalabilidad(const Config& cfg, const string& dir, const vector<string>& backends,
+                         const vector<Entrada>& entradas) {
+    bool weak = (cfg.scaling == "weak");
+    if (!weak && cfg.scaling != "strong") {
+        cerr << "Modo de escalabilidad desconocido: " << cfg.scaling << "\n";
+        return 1;
+    }
+
+    Entrada base;
+    if (weak) {
+        if (!prepararSintetica(dir, cfg.weakBase, base)) return 1;
+    } else {
+        if (entradas.empty()) {
+            cerr << "El modo strong necesita una entrada\n";
+            return 1;
+        }
+        base = entradas[0];
+    }
+
+    vector<int> sweep;
+    for (int p = 1; p < cfg.maxWorkers; p *= 2) sweep.push_back(p);
+    sweep.push_back(cfg.maxWorkers);
+
+    // En weak scaling cada p tiene su propia imagen con p veces las filas de la base
+    vector<Entrada> imagenes;
+    for (int p : sweep) {
+        if (!weak || p == 1) {
+            imagenes.push_back(base);
+            continue;
+        }
+        Entrada e;
+        string spec = to_string(base.width) + "x" + to_string(base.height * p) + "x" + to_string(base.channels);
+        if (!prepararSintetica(dir, spec, e)) return 1;
+        imagenes.push_back(e);
+    }
+
+    unsigned cores = thread::hardware_concurrency();
+    ostringstream csv, json, notas;
+    csv << "mode,backend,filter,input,requested_workers,reported_workers,compute_median_ns,"
+        << "speedup,efficiency,karp_flatt\n";
+    json << "[";
+    bool primero = true;
+
+    printf("Escalabilidad %s (%u núcleos disponibles)\n", weak ? "weak" : "strong", cores);
+    for (const string& backend : backends) {
+        if (backend == "serial") continue;
+        for (const string& filter : cfg.filters) {
+            printf("\n%s / %s\n%4s %4s %-28s %12s %9s %10s %11s\n", backend.c_str(), filter.c_str(),
+                   "p", "real", "input", "median ms", "speedup", "eficiencia", "Karp-Flatt");
+            double t1 = 0.0;
+            double kfPrimero = -1.0, kfUltimo = -1.0;
+            bool workersFijos = false;
+            int workersReportados = -1;
+            for (size_t k = 0; k < sweep.size(); k++) {
+                int p = sweep[k];
+                Resultado r = medir(cfg, dir, backend, filter, imagenes[k], p);
+                if (!r.ok) continue;
+                double tp = percentil(r.computeNs, 50);
+                if (k == 0) t1 = tp;
+                if (r.reportedWorkers != p) workersFijos = true;
+                workersReportados = r.reportedWorkers;
+
+                double ratio = (tp > 0 && t1 > 0) ? t1 / tp : 0.0;
+                double speedup = weak ? p * ratio : ratio;
+                double eficiencia = weak ? ratio : speedup / p;
+                double kf = -1.0;
+                if (!weak && p > 1 && speedup > 0) {
+                    kf = (1.0 / speedup - 1.0 / p) / (1.0 - 1.0 / p);
+                    if (kfPrimero < 0) kfPrimero = kf;
+                    kfUltimo = kf;
+                }
+
+                printf("%4d %4d %-28s %12.3f %9.2f %10.2f ", p, r.reportedWorkers, r.input.c_str(),
+                       tp / 1e6, speedup, eficiencia);
+                if (kf >= 0) printf("%11.3f\n", kf); else printf("%11s\n", "-");
+
+                csv << cfg.scaling << "," << backend << "," << filter << "," << r.input << "," << p << ","
+                    << r.reportedWorkers << "," << (long long)tp << "," << speedup << "," << eficiencia << ",";
+                if (kf >= 0) csv << kf;
+                csv << "\n";
+                json << (primero ? "" : ",") << "\n  {\"mode\":\"" << cfg.scaling << "\",\"backend\":\"" << backend
+                     << "\",\"filter\":\"" << filter << "\",\"input\":\"" << r.input
+                     << "\",\"requested_workers\":" << p << ",\"reported_workers\":" << r.reportedWorkers
+                     << ",\"compute_median_ns\":" << (long long)tp << ",\"speedup\":" << speedup
+                     << ",\"efficiency\":" << eficiencia;
+                if (kf >= 0) json << ",\"karp_flatt\":" << kf;
+                json << "}";
+                primero = false;
+            }
+
+            if (workersFijos && backend == "pthreads") {
+                notas << "- pthreads/" << filter << ": filter_phtreads.cpp reporta siempre " << workersReportados
+                      << " hilos. main crea exactamente 4 pthreads, uno por cuadrante alrededor de (midX, midY),"
+                      << " así que pedir más hilos no agrega trabajo en paralelo y el tiempo queda plano desde"
+                      << " p = 4; con menos núcleos que 4 los cuadrantes sólo se turnan.\n";
+            } else if (workersFijos) {
+                notas << "- " << backend << "/" << filter << ": el backend no usó el número de workers pedido"
+                      << " (reporta " << workersReportados << ").\n";
+            }
+            if (!weak && kfPrimero >= 0 && kfUltimo > kfPrimero * 1.5 && kfUltimo > 0.05) {
+                notas << "- " << backend << "/" << filter << ": la fracción serial de Karp–Flatt crece de "
+                      << kfPrimero << " a " << kfUltimo << "; el límite es la sobrecarga de coordinación"
+                      << " (sincronización, comunicación o desbalance), no una parte serial fija.\n";
+            }
+        }
+    }
+    json << "\n]\n";
+
+    if (cores > 0 && (unsigned)cfg.maxWorkers > cores) {
+        notas << "- El barrido llega a " << cfg.maxWorkers << " workers con " << cores
+              << " núcleos: por encima de " << cores << " hay sobresuscripción y no se espera speedup.\n";
+    }
+    string textoNotas = notas.str();
+    if (!textoNotas.empty()) printf("\nNotas:\n%s", textoNotas.c_str());
+
+    escribirSalidas(cfg, csv.str(), json.str());
+    return 0;
+}
+
+// Techo de la máquina para un número de hilos: ancho de banda sostenido y FLOP/s pico
+struct Techo {
+    double gbs;
+    double gflops;
+};
+
+// sondaAnchoBanda: triad a[i] = b[i] + s * c[i] sobre arreglos mucho más grandes que la
+// caché, repartidos entre hilos; se cuentan 24 bytes por elemento como en STREAM
+double sondaAnchoBanda(int hilos) {
+    const size_t n = 1 << 23;  // 64 MB por arreglo
+    vector<double> a(n, 0.0), b(n, 1.0), c(n, 2.0);
+    double mejor = 0.0;
+    for (int rep = 0; rep < 5; rep++) {
+        auto inicio = chrono::steady_clock::now();
+        vector<thread> pool;
+        for (int t = 0; t < hilos; t++) {
+            pool.push_back(thread([&, t]() {
+                size_t desde = n * t / hilos, hasta = n * (t + 1) / hilos;
+                for (size_t i = desde; i < hasta; i++) a[i] = b[i] + 3.0 * c[i];
+            }));
+        }
+        for (thread& th : pool) th.join();
+        double seg = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+        mejor = max(mejor, 24.0 * n / seg / 1e9);
+    }
+    if (a[n / 2] != 7.0) cerr << "Sonda de ancho de banda inválida\n";
+    return mejor;
+}
+
+// sondaFlops: cadenas independientes de multiplicación-suma en float que el compilador
+// puede vectorizar; el pico depende de las opciones con que se compile el benchmark
+double sondaFlops(int hilos) {
+    const int iter = 1 << 22;
+    double mejor = 0.0;
+    for (int rep = 0; rep < 3; rep++) {
+        vector<float> sumidero(hilos);
+        auto inicio = chrono::steady_clock::now();
+        vector<thread> pool;
+        for (int t = 0; t < hilos; t++) {
+            pool.push_back(thread([&, t]() {
+                float acc[8][16];
+                for (int j = 0; j < 8; j++) for (int k = 0; k < 16; k++) acc[j][k] = (float)(j + k + t);
+                const float m = 0.999999f, s = 1e-6f;
+                for (int i = 0; i < iter / 128; i++) {
+                    for (int j = 0; j < 8; j++) {
+                        for (int k = 0; k < 16; k++) acc[j][k] = acc[j][k] * m + s;
+                    }
+                }
+                float total = 0.0f;
+                for (int j = 0; j < 8; j++) for (int k = 0; k < 16; k++) total += acc[j][k];
+                sumidero[t] = total;
+            }));
+        }
+        for (thread& th : pool) th.join();
+        double seg = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+        mejor = max(mejor, 2.0 * (iter / 128) * 128 * hilos / seg / 1e9);
+        if (sumidero[0] < 0.0f) cerr << "Sonda de FLOP/s inválida\n";
+    }
+    return mejor;
+}
+
+// Costo de un filtro por muestra de entrada, derivado de su especificación (la misma que
+// entiende crearFiltro en filter.cpp). Cada toma de la convolución es una multiplicación y
+// una suma en float, también las tomas en cero de laplace y sharpen, que el código calcula
+// igual; la luminancia de gray+<conv> son 3 productos y 2 sumas por píxel. El epílogo de
+// operaciones puntuales (",gamma:...") es una búsqueda en una tabla que queda en caché: no
+// suma FLOP ni tráfico mínimo.
+struct CostoFiltro {
+    double flops;         // por muestra de entrada
+    double bytesMin;      // tráfico mínimo: cada entrada se lee y cada salida se escribe una vez
+    double bytesNoReuso;  // sin reutilización en caché: cada toma vuelve a leer memoria
+    double flopsPorMuestra() const { return flops; }
+    double bytesMinimos() const { return bytesMin; }
+    double bytesSinReuso() const { return bytesNoReuso; }
+};
+
+// Image guarda cada muestra como int, cualquiera sea el maxColor del archivo
+const double BYTES_MUESTRA = sizeof(int);
+
+// ladoKernel: lado del kernel cuadrado de cada convolución de crearConvolucion, 0 si no es
+// una; un kernel nuevo tiene que agregarse acá para que el roofline lo mida
+int ladoKernel(const string& nombre) {
+    if (nombre == "blur" || nombre == "laplace" || nombre == "sharpen") return 3;
+    return 0;
+}
+
+// costoFiltro: false si la especificación no tiene modelo: equalize, clahe, las que son
+// sólo operaciones puntuales (sin FLOP no hay intensidad aritmética) o desconocidas
+bool costoFiltro(const string& filter, int channels, CostoFiltro& c) {
+    string cabeza = filter.substr(0, filter.find(','));
+    int salida = channels;
+    double luma = 0.0;
+    int taps = 0;
+    if (cabeza == "gray" || cabeza == "gray709" || cabeza.compare(0, 5, "gray+") == 0 ||
+        cabeza.compare(0, 8, "gray709+") == 0) {
+        if (channels != 3) return false;
+        salida = 1;
+        luma = 5.0;
+        size_t mas = cabeza.find('+');
+        if (mas != string::npos) {
+            int lado = ladoKernel(cabeza.substr(mas + 1));
+            if (lado == 0) return false;
+            taps = lado * lado;
+        }
+    } else {
+        int lado = ladoKernel(cabeza);
+        if (lado == 0) return false;
+        taps = lado * lado;
+    }
+    // Por píxel y después por muestra de entrada, que es lo que cuenta estudioRoofline
+    double flopsPixel = luma + 2.0 * taps * salida;
+    double minPixel = (channels + salida) * BYTES_MUESTRA;
+    double lecturas = taps == 0 ? channels : (double)taps * (luma > 0 ? channels : salida);
+    double noReusoPixel = (lecturas + salida) * BYTES_MUESTRA;
+    c.flops = flopsPixel / channels;
+    c.bytesMin = minPixel / channels;
+    c.bytesNoReuso = noReusoPixel / channels;
+    return true;
+}
+
+// estudioRoofline: ubica cada filtro y backend en el modelo roofline. La intensidad
+// aritmética usa el tráfico mínimo; si el kernel queda bajo el techo de memoria con
+// esa intensidad, está limitado por ancho de banda aunque la caché funcione perfecto.
+// El GB/s de la tabla (modeled_gbs) no se mide: es ese tráfico mínimo dividido por el
+// tiempo de cómputo, así que es una cota inferior del tráfico real.
+int estudioRoofline(const Config& cfg, const string& dir, const vector<string>& backends,
+                    const vector<Entrada>& entradas) {
+    if (entradas.empty()) {
+        cerr << "El modo roofline necesita una entrada\n";
+        return 1;
+    }
+    const Entrada& e = entradas[0];
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    map<int, Techo> techos;
+    auto techo = [&](int hilos) {
+        hilos = max(1, min(hilos, (int)cores));
+        if (!techos.count(hilos)) {
+            cerr << "Midiendo techos con " << hilos << " hilo(s)...\n";
+            Techo t = {sondaAnchoBanda(hilos), sondaFlops(hilos)};
+            techos[hilos] = t;
+        }
+        return techos[hilos];
+    };
+
+    ostringstream csv, json;
+    csv << "backend,filter,input,workers,flops_per_sample,bytes_per_sample,arithmetic_intensity,"
+        << "gflops,modeled_gbs,peak_gflops,peak_gbs,ridge,attainable_gflops,fraction_of_roof,bound\n";
+    json << "[";
+    bool primero = true;
+
+    printf("Roofline sobre %s (%dx%dx%d)\n", e.nombre.c_str(), e.width, e.height, e.channels);
+    printf("%-9s %-8s %3s %7s %9s %8s %8s %8s %9s  %s\n", "backend", "filter", "w", "AI F/B",
+           "GFLOP/s", "GB/s mod", "pico GF", "pico GB", "% techo", "limitado por");
+    for (const string& filter : cfg.filters) {
+        CostoFiltro costo;
+        if (!costoFiltro(filter, e.channels, costo)) {
+            cerr << "Sin modelo de costo para " << filter << " con " << e.channels << " canal(es): se omite\n";
+            continue;
+        }
+        double ai = costo.flopsPorMuestra() / costo.bytesMinimos();
+        for (const string& backend : backends) {
+            vector<int> workers = cfg.workers;
+            if (backend == "serial") workers = {1};
+            if (backend == "pthreads") workers = {4};
+            for (int w : workers) {
+                Resultado r = medir(cfg, dir, backend, filter, e, w);
+                if (!r.ok) continue;
+                double seg = percentil(r.computeNs, 50) / 1e9;
+                double muestras = (double)e.width * e.height * e.channels;
+                double gflops = muestras * costo.flopsPorMuestra() / seg / 1e9;
+                double modeledGbs = muestras * costo.bytesMinimos() / seg / 1e9;
+
+                Techo t = techo(r.reportedWorkers);
+                double ridge = t.gflops / t.gbs;
+                double alcanzable = min(t.gflops, ai * t.gbs);
+                double fraccion = gflops / alcanzable;
+                const char* limite = (ai < ridge) ? "memoria" : "cómputo";
+
+                string barra(20, '.');
+                for (int k = 0; k < 20 && k < (int)(fraccion * 20 + 0.5); k++) barra[k] = '#';
+                printf("%-9s %-8s %3d %7.2f %9.2f %8.2f %8.1f %8.1f %8.1f%%  %s [%s]\n",
+                       backend.c_str(), filter.c_str(), r.reportedWorkers, ai, gflops, modeledGbs,
+                       t.gflops, t.gbs, fraccion * 100, limite, barra.c_str());
+
+                csv << backend << "," << filter << "," << e.nombre << "," << r.reportedWorkers << ","
+                    << costo.flopsPorMuestra() << "," << costo.bytesMinimos() << "," << ai << "," << gflops << ","
+                    << modeledGbs << "," << t.gflops << "," << t.gbs << "," << ridge << "," << alcanzable << ","
+                    << fraccion << "," << limite << "\n";
+                json << (primero ? "" : ",") << "\n  {\"backend\":\"" << backend << "\",\"filter\":\"" << filter
+                     << "\",\"input\":\"" << e.nombre << "\",\"workers\":" << r.reportedWorkers
+                     << ",\"flops_per_sample\":" << costo.flopsPorMuestra()
+                     << ",\"bytes_per_sample\":" << costo.bytesMinimos()
+                     << ",\"bytes_per_sample_no_reuse\":" << costo.bytesSinReuso()
+                     << ",\"arithmetic_intensity\":" << ai << ",\"gflops\":" << gflops << ",\"modeled_gbs\":" << modeledGbs
+                     << ",\"peak_gflops\":" << t.gflops << ",\"peak_gbs\":" << t.gbs << ",\"ridge\":" << ridge
+                     << ",\"attainable_gflops\":" << alcanzable << ",\"fraction_of_roof\":" << fraccion
+                     << ",\"bound\":\"" << limite << "\"}";
+                primero = false;
+            }
+        }
+    }
+    json << "\n]\n";
+
+    CostoFiltro ref;
+    if (costoFiltro("blur", e.channels, ref)) {
+        printf("\nIntensidad de blur con tráfico mínimo: %.2f FLOP/byte; sin reutilización en caché: %.2f"
+               " FLOP/byte.\n", ref.flopsPorMuestra() / ref.bytesMinimos(), ref.flopsPorMuestra() / ref.bytesSinReuso());
+    }
+    printf("GB/s mod es el tráfico mínimo del modelo sobre el tiempo medido, no un ancho de banda medido.\n");
+    printf("Un kernel muy por debajo de su techo no está limitado por la máquina sino por el código\n"
+           "(comprobaciones de borde, conversión int/float, accesos al kernel como vector<vector<float>>).\n");
+
+    escribirSalidas(cfg, csv.str(), json.str());
+    return 0;
+}
+
+// afinarOmp: mide filter_omp con cada combinación de planificación, filas por banda y
+// proc_bind, y ordena por tiempo total: con tasks cada filtro se guarda mientras siguen
+// las bandas de los otros, así que la región paralela (region_ns, que también se muestra)
+// incluye escrituras que en los otros modos van después. Imprime las combinaciones de la
+// más rápida a la más lenta y las variables de entorno de la mejor.
+int afinarOmp(const Config& cfg, const string& dir, const vector<Entrada>& entradas) {
+    if (entradas.empty()) {
+        cerr << "El modo --omp-tune necesita una entrada\n";
+        return 1;
+    }
+    const Entrada& e = entradas[0];
+    int hilos = cfg.maxWorkers;
+
+    struct Prueba {
+        string schedule, chunk, bind;
+        vector<long long> regionNs, wallNs;
+    };
+    vector<Prueba> pruebas;
+    for (const string& sch : cfg.ompSchedules) {
+        for (const string& chunk : cfg.ompChunks) {
+            for (const string& bind : cfg.ompBinds) {
+                Prueba p = {sch, chunk, bind, {}, {}};
+                string entorno = "FILTER_OMP_SCHEDULE=" + sch + " FILTER_OMP_CHUNK=" + chunk;
+                if (bind != "default") entorno += " FILTER_OMP_BIND=" + bind;
+                cerr << entorno << "\n";
+                bool ok = true;
+                for (int i = 0; i < cfg.warmup + cfg.repeat && ok; i++) {
+                    Corrida corrida;
+                    ok = ejecutarBackend(cfg.bins, dir, "omp", cfg.filters[0], e.path, e.channels, hilos,
+                                         corrida, entorno) && corrida.regionNs >= 0;
+                    if (ok && i >= cfg.warmup) {
+                        p.regionNs.push_back(corrida.regionNs);
+                        p.wallNs.push_back(corrida.wallNs);
+                    }
+                }
+                if (!ok) {
+                    cerr << "Falló " << entorno << "\n";
+                    continue;
+                }
+                pruebas.push_back(p);
+            }
+        }
+    }
+    if (pruebas.empty()) {
+        cerr << "Ninguna combinación terminó bien\n";
+        return 1;
+    }
+    sort(pruebas.begin(), pruebas.end(), [](const Prueba& a, const Prueba& b) {
+        return percentil(a.wallNs, 50) < percentil(b.wallNs, 50);
+    });
+
+    ostringstream csv, json;
+    csv << "input,workers,schedule,chunk,bind,samples,wall_median_ns,wall_p10_ns,wall_p90_ns,"
+        << "region_median_ns,vs_best\n";
+    json << "[";
+    double mejor = percentil(pruebas[0].wallNs, 50);
+    printf("Planificación de filter_omp sobre %s (%dx%dx%d), %d hilos\n", e.nombre.c_str(), e.width,
+           e.height, e.channels, hilos);
+    printf("%-8s %6s %-8s %12s %12s %12s %12s %8s\n", "schedule", "chunk", "bind", "total p10",
+           "total med", "total p90", "región med", "vs mejor");
+    for (size_t i = 0; i < pruebas.size(); i++) {
+        const Prueba& p = pruebas[i];
+        double med = percentil(p.wallNs, 50), region = percentil(p.regionNs, 50);
+        printf("%-8s %6s %-8s %12.3f %12.3f %12.3f %12.3f %8.3f\n", p.schedule.c_str(), p.chunk.c_str(),
+               p.bind.c_str(), percentil(p.wallNs, 10) / 1e6, med / 1e6, percentil(p.wallNs, 90) / 1e6,
+               region / 1e6, med / mejor);
+        csv << e.nombre << "," << hilos << "," << p.schedule << "," << p.chunk << "," << p.bind << ","
+            << p.wallNs.size() << "," << (long long)med << "," << (long long)percentil(p.wallNs, 10) << ","
+            << (long long)percentil(p.wallNs, 90) << "," << (long long)region << "," << med / mejor << "\n";
+        json << (i ? "," : "") << "\n  {\"input\":\"" << e.nombre << "\",\"workers\":" << hilos
+             << ",\"schedule\":\"" << p.schedule << "\",\"chunk\":" << p.chunk << ",\"bind\":\"" << p.bind
+             << "\",\"wall_median_ns\":" << (long long)med << ",\"region_median_ns\":" << (long long)region
+             << ",\"vs_best\":" << med / mejor << "}";
+    }
+    json << "\n]\n";
+
+    const Prueba& p = pruebas[0];
+    printf("\nMejor combinación para esta máquina:\n  FILTER_OMP_SCHEDULE=%s FILTER_OMP_CHUNK=%s%s\n",
+           p.schedule.c_str(), p.chunk.c_str(), p.bind == "default" ? "" : (" FILTER_OMP_BIND=" + p.bind).c_str());
+
+    escribirSalidas(cfg, csv.str(), json.str());
+    return 0;
+}
+
+// expulsarDeCache: baja a disco lo pendiente del archivo y le pide al kernel que suelte sus
+// páginas del page cache, para que la corrida siguiente lea del dispositivo
+bool expulsarDeCache(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fdatasync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+}
+
+// fraccionEnCache: parte del archivo (0 a 1) que está en el page cache según mincore;
+// -1 si no se pudo consultar
+double fraccionEnCache(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return -1.0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return -1.0;
+    }
+    void* m = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return -1.0;
+    long pagina = sysconf(_SC_PAGESIZE);
+    size_t paginas = (st.st_size + pagina - 1) / pagina;
+    vector<unsigned char> residentes(paginas);
+    double fraccion = -1.0;
+    if (mincore(m, st.st_size, residentes.data()) == 0) {
+        size_t n = 0;
+        for (size_t i = 0; i < paginas; i++) n += residentes[i] & 1;
+        fraccion = (double)n / paginas;
+    }
+    munmap(m, st.st_size);
+    return fraccion;
+}
+
+// estudioStreamIO: filter --stream con cada modo de E/S sobre cada entrada binaria. Antes de
+// cada corrida la entrada sale del page cache (expulsarDeCache), así todos los modos leen
+// del disco; después se mide qué fracción de la entrada y de la salida quedó en caché, que
+// es lo que O_DIRECT deja libre para el resto del sistema. load es el tiempo esperando
+// datos y save el de codificar y escribir (timing.h).
+int estudioStreamIO(const Config& cfg, const string& dir, const vector<Entrada>& entradas) {
+    struct Prueba {
+        string input, modo;
+        vector<long long> wallNs, computeNs, loadNs, saveNs;
+        double cacheEntrada, cacheSalida;
+    };
+    vector<Prueba> pruebas;
+    const string& filter = cfg.filters[0];
+    for (const Entrada& e : entradas) {
+        for (const string& modo : cfg.streamModes) {
+            Prueba p = {e.nombre, modo, {}, {}, {}, {}, 0.0, 0.0};
+            string entorno = "FILTER_STREAM_IO=" + modo + " FILTER_STREAM_ROWS=" + cfg.streamRows;
+            bool ok = true;
+            for (int i = 0; i < cfg.warmup + cfg.repeat && ok; i++) {
+                Corrida corrida;
+                expulsarDeCache(e.path);
+                ok = ejecutarBackend(cfg.bins, dir, "stream", filter, e.path, e.channels, 1, corrida, entorno);
+                if (!ok || i < cfg.warmup) continue;
+                p.wallNs.push_back(corrida.wallNs);
+                p.computeNs.push_back(corrida.computeNs);
+                ifstream in((dir + "/timing.jsonl").c_str());
+                string linea;
+                getline(in, linea);
+                p.loadNs.push_back(extraerEntero(linea, "load"));
+                p.saveNs.push_back(extraerEntero(linea, "save"));
+                p.cacheEntrada = fraccionEnCache(e.path);
+                p.cacheSalida = fraccionEnCache(corrida.salida);
+            }
+            if (!ok) {
+                cerr << "Falló " << entorno << " sobre " << e.nombre
+                     << " (¿entrada ASCII o filtro que no funciona por bandas?)\n";
+                continue;
+            }
+            pruebas.push_back(p);
+        }
+    }
+    if (pruebas.empty()) {
+        cerr << "Ninguna corrida terminó bien\n";
+        return 1;
+    }
+
+    ostringstream csv, json;
+    csv << "input,filter,mode,rows,samples,wall_median_ns,compute_median_ns,load_median_ns,save_median_ns,"
+        << "input_cached,output_cached\n";
+    json << "[";
+    printf("filter --stream %s, %s filas por banda\n", filter.c_str(), cfg.streamRows.c_str());
+    printf("%-28s %-9s %12s %12s %12s %12s %10s %10s\n", "input", "modo", "total med", "cómputo med",
+           "load med", "save med", "entrada $", "salida $");
+    for (size_t i = 0; i < pruebas.size(); i++) {
+        const Prueba& p = pruebas[i];
+        double wall = percentil(p.wallNs, 50), comp = percentil(p.computeNs, 50);
+        double load = percentil(p.loadNs, 50), save = percentil(p.saveNs, 50);
+        printf("%-28s %-9s %12.3f %12.3f %12.3f %12.3f %9.1f%% %9.1f%%\n", p.input.c_str(), p.modo.c_str(),
+               wall / 1e6, comp / 1e6, load / 1e6, save / 1e6, 100 * p.cacheEntrada, 100 * p.cacheSalida);
+        csv << p.input << "," << filter << "," << p.modo << "," << cfg.streamRows << "," << p.wallNs.size()
+            << "," << (long long)wall << "," << (long long)comp << "," << (long long)load << ","
+            << (long long)save << "," << p.cacheEntrada << "," << p.cacheSalida << "\n";
+        json << (i ? "," : "") << "\n  {\"input\":\"" << p.input << "\",\"filter\":\"" << filter
+             << "\",\"mode\":\"" << p.modo << "\",\"rows\":" << cfg.streamRows
+             << ",\"wall_median_ns\":" << (long long)wall << ",\"compute_median_ns\":" << (long long)comp
+             << ",\"load_median_ns\":" << (long long)load << ",\"save_median_ns\":" << (long long)save
+             << ",\"input_cached\":" << p.cacheEntrada << ",\"output_cached\":" << p.cacheSalida << "}";
+    }
+    json << "\n]\n";
+    printf("Los porcentajes son la fracción de cada archivo que quedó en el page cache.\n");
+
+    escribirSalidas(cfg, csv.str(), json.str());
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    Config cfg;
+    if (!leerArgumentos(argc, argv, cfg)) return 1;
+
+    string dir = crearDirectorioTemporal("benchmark");
+    if (dir.empty()) {
+        cerr << "No se pudo crear el directorio temporal\n";
+        return 1;
+    }
+
+    vector<string> backends = resolverBackends(cfg.bins, cfg.backends);
+
+    vector<Entrada> entradas;
+    for (const string& path : cfg.inputs) {
+        Entrada e;
+        e.path = rutaAbsoluta(path);
+        e.nombre = path;
+        if (e.path.empty() || !leerCabecera(e.path, e.width, e.height, e.channels)) {
+            cerr << "Entrada omitida: " << path << "\n";
+            continue;
+        }
+        entradas.push_back(e);
+    }
+    for (const string& spec : cfg.synthetic) {
+        Entrada e;
+        if (prepararSintetica(dir, spec, e, cfg.streamIo)) entradas.push_back(e);
+    }
+
+    if (cfg.roofline) {
+        int status = estudioRoofline(cfg, dir, backends, entradas);
+        system(("rm -rf '" + dir + "'").c_str());
+        return status;
+    }
+
+    if (cfg.ompTune) {
+        int status = afinarOmp(cfg, dir, entradas);
+        system(("rm -rf '" + dir + "'").c_str());
+        return status;
+    }
+
+    if (cfg.streamIo) {
+        int status = estudioStreamIO(cfg, dir, entradas);
+        system(("rm -rf '" + dir + "'").c_str());
+        return status;
+    }
+
+    if (!cfg.scaling.empty()) {
+        int status = estudioEscalabilidad(cfg, dir, backends, entradas);
+        system(("rm -rf '" + dir + "'").c_str());
+        return status;
+    }
+
+    vector<Resultado> resultados;
+    for (const Entrada& e : entradas) {
+        for (const string& filter : cfg.filters) {
+            for (const string& backend : backends) {
+                // serial no tiene hilos y filter_phtreads siempre usa sus 4 cuadrantes
+                vector<int> workers = cfg.workers;
+                if (backend == "serial") workers = {1};
+                if (backend == "pthreads") workers = {4};
+
+                for (int w : workers) resultados.push_back(medir(cfg, dir, backend, filter, e, w));
+            }
+        }
+    }
+
+    // La referencia es ConvolutionFilter::aplicar de un solo hilo (backend serial)
+    auto referencia = [&](const Resultado& r) {
+        for (const Resultado& s : resultados) {
+            if (s.ok && s.backend == "serial" && s.filter == r.filter && s.input == r.input) {
+                return percentil(s.computeNs, 50);
+            }
+        }
+        return 0.0;
+    };
+
+    map<string, Comparacion> base;
+    bool comparar = !cfg.comparePath.empty();
+    if (comparar) base = leerComparacion(cfg.comparePath);
+
+    ostringstream csv, json;
+    csv << "backend,filter,input,width,height,channels,workers,samples,"
+        << "compute_min_ns,compute_p10_ns,compute_median_ns,compute_p90_ns,compute_max_ns,"
+        << "wall_median_ns,mpixels_per_s,speedup_vs_serial";
+    if (comparar) csv << ",base_compute_median_ns,base_wall_median_ns,compute_gain,wall_gain";
+    csv << "\n";
+    json << "[";
+    printf("%-9s %-8s %-28s %3s %12s %12s %12s %9s %8s",
+           "backend", "filter", "input", "w", "p10 ms", "median ms", "p90 ms", "MPix/s", "speedup");
+    if (comparar) printf(" %9s %9s", "vs base", "wall vs");
+    printf("\n");
+
+    bool primero = true;
+    for (const Resultado& r : resultados) {
+        if (!r.ok) continue;
+        double med = percentil(r.computeNs, 50);
+        double ref = referencia(r);
+        double mpix = med > 0 ? (double)r.width * r.height / (med / 1e9) / 1e6 : 0.0;
+        double speedup = (med > 0 && ref > 0) ? ref / med : 0.0;
+
+        double wallMed = percentil(r.wallNs, 50);
+
+        printf("%-9s %-8s %-28s %3d %12.3f %12.3f %12.3f %9.2f %8.2f",
+               r.backend.c_str(), r.filter.c_str(), r.input.c_str(), r.workers,
+               percentil(r.computeNs, 10) / 1e6, med / 1e6, percentil(r.computeNs, 90) / 1e6, mpix, speedup);
+
+        // Mejora respecto a la corrida anterior: T(base) / T(ahora), > 1 es más rápido
+        Comparacion c = {0.0, 0.0};
+        if (comparar) {
+            map<string, Comparacion>::iterator it =
+                base.find(r.backend + "/" + r.filter + "/" + r.input + "/" + to_string(r.workers));
+            if (it != base.end()) c = it->second;
+            printf(" %9.3f %9.3f", med > 0 ? c.computeNs / med : 0.0, wallMed > 0 ? c.wallNs / wallMed : 0.0);
+        }
+        printf("\n");
+
+        csv << r.backend << "," << r.filter << "," << r.input << "," << r.width << "," << r.height << ","
+            << r.channels << "," << r.workers << "," << r.computeNs.size() << ","
+            << (long long)percentil(r.computeNs, 0) << "," << (long long)percentil(r.computeNs, 10) << ","
+            << (long long)med << "," << (long long)percentil(r.computeNs, 90) << ","
+            << (long long)percentil(r.computeNs, 100) << "," << (long long)wallMed << ","
+            << mpix << "," << speedup;
+        if (comparar) {
+            csv << "," << (long long)c.computeNs << "," << (long long)c.wallNs << ","
+                << (med > 0 ? c.computeNs / med : 0.0) << "," << (wallMed > 0 ? c.wallNs / wallMed : 0.0);
+        }
+        csv << "\n";
+
+        json << (primero ? "" : ",") << "\n  {\"backend\":\"" << r.backend << "\",\"filter\":\"" << r.filter
+             << "\",\"input\":\"" << r.input << "\",\"width\":" << r.width << ",\"height\":" << r.height
+             << ",\"channels\":" << r.channels << ",\"workers\":" << r.workers << ",\"compute_ns\":[";
+        for (size_t i = 0; i < r.computeNs.size(); i++) json << (i ? "," : "") << r.computeNs[i];
+        json << "],\"compute_median_ns\":" << (long long)med
+             << ",\"compute_p10_ns\":" << (long long)percentil(r.computeNs, 10)
+             << ",\"compute_p90_ns\":" << (long long)percentil(r.computeNs, 90)
+             << ",\"wall_median_ns\":" << (long long)wallMed
+             << ",\"mpixels_per_s\":" << mpix << ",\"speedup_vs_serial\":" << speedup;
+        if (comparar) {
+            json << ",\"compute_gain\":" << (med > 0 ? c.computeNs / med : 0.0)
+                 << ",\"wall_gain\":" << (wallMed > 0 ? c.wallNs / wallMed : 0.0);
+        }
+        json << "}";
+        primero = false;
+    }
+    json << "\n]\n";
+
+    escribirSalidas(cfg, csv.str(), json.str());
+
+    system(("rm -rf '" + dir + "'").c_str());
+    return 0;
+}
@@ -0,0 +1,361 @@
+#ifndef BULKIO_H
+#define BULKIO_H
+
+// bulkio.h: E/S de archivos por lotes para el modo batch de filter. Las lecturas de los
+// archivos que vienen y las escrituras de los que ya terminaron se envían juntas a un
+// io_uring (syscalls directas, sin liburing) y el núcleo las atiende mientras los filtros
+// corren; cuando hace falta un archivo se llama a completar().
+//
+// Los datos pasan por ranuras fijas registradas en el anillo (IORING_REGISTER_BUFFERS),
+// así el núcleo no fija y suelta las páginas en cada operación: cada archivo se parte en
+// tramos del tamaño de una ranura, las lecturas se copian de la ranura al destino y las
+// escrituras al revés. Como mucho hay tantas operaciones en vuelo como ranuras.
+//
+// Si io_uring no está disponible (núcleo viejo, deshabilitado por sysctl o seccomp) o
+// FILTER_IO=pread, completar() hace pread/pwrite en orden.
+//   FILTER_IO=uring|pread         forzar un modo (por defecto uring si se puede)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BULKIO_URING 1
+#endif
+#include "memory.h"
+
+class BulkIO {
+public:
+    // Archivo: un archivo del lote; en lecturas datos recibe el contenido, en escrituras
+    // es lo que se escribe. El objeto debe seguir vivo hasta completar()
+    struct Archivo {
+        std::string path;
+        std::string datos;
+        bool ok = false;
+    };
+
+private:
+    // El núcleo fija en memoria las ranuras registradas: 32 x 256 KB = 8 MB en vuelo
+    static const unsigned ENTRADAS = 32;              // profundidad del anillo
+    static const size_t TAM_RANURA = 256 << 10;       // bytes por operación
+
+    struct Tramo {
+        Archivo* archivo;
+        int fd;
+        size_t offset, len;
+        bool escritura;
+    };
+
+    struct EstadoArchivo {
+        Archivo* archivo;
+        int fd;
+        int pendientes;   // tramos sin terminar
+    };
+
+    std::deque<Tramo> cola;              // tramos esperando ranura
+    std::vector<EstadoArchivo> abiertos;
+    bool uring;
+
+#ifdef BULKIO_URING
+    int ringFd;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray, *cqHead, *cqTail, *cqMask;
+    io_uring_sqe* sqes;
+    io_uring_cqe* cqes;
+    void* sqRing;
+    void* cqRing;
+    size_t sqRingSize, cqRingSize, sqesSize;
+    bool unSoloMapeo;
+    char* ranuras;
+    std::vector<Tramo> enVuelo;          // tramo de cada ranura
+    std::vector<int> libres;             // ranuras libres
+    int activas;
+    unsigned sinEnviar;                  // sqes preparadas que el núcleo aún no vio
+
+    bool iniciarUring() {
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        ringFd = (int)syscall(__NR_io_uring_setup, ENTRADAS, &p);
+        if (ringFd < 0) return false;
+        sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        unSoloMapeo = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (unSoloMapeo) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                      IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            cerrarUring();
+            return false;
+        }
+        cqRing = unSoloMapeo ? sqRing
+                             : mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                    ringFd, IORING_OFF_CQ_RING);
+        sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                                   IORING_OFF_SQES);
+        if (cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+            cerrarUring();
+            return false;
+        }
+        char* sq = (char*)sqRing;
+        char* cq = (char*)cqRing;
+        sqHead = (unsigned*)(sq + p.sq_off.head);
+        sqTail = (unsigned*)(sq + p.sq_off.tail);
+        sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+        sqArray = (unsigned*)(sq + p.sq_off.array);
+        cqHead = (unsigned*)(cq + p.cq_off.head);
+        cqTail = (unsigned*)(cq + p.cq_off.tail);
+        cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+
+        // Una ranura por entrada del anillo, todas en un solo bloque registrado
+        ranuras = (char*)mmap(NULL, (size_t)ENTRADAS * TAM_RANURA, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ranuras == MAP_FAILED) {
+            ranuras = NULL;
+            cerrarUring();
+            return false;
+        }
+        std::vector<iovec> iov(ENTRADAS);
+        for (unsigned i = 0; i < ENTRADAS; i++) {
+            iov[i].iov_base = ranuras + (size_t)i * TAM_RANURA;
+            iov[i].iov_len = TAM_RANURA;
+        }
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, iov.data(), ENTRADAS) < 0) {
+            cerrarUring();
+            return false;
+        }
+        MemoryStats::instance().add(MEM_FILE, (long long)ENTRADAS * TAM_RANURA);
+        enVuelo.resize(ENTRADAS);
+        for (int i = (int)ENTRADAS - 1; i >= 0; i--) libres.push_back(i);
+        activas = 0;
+        sinEnviar = 0;
+        return true;
+    }
+
+    void cerrarUring() {
+        if (ranuras) munmap(ranuras, (size_t)ENTRADAS * TAM_RANURA);
+        if (sqes && sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqRing && cqRing != MAP_FAILED && !unSoloMapeo) munmap(cqRing, cqRingSize);
+        if (sqRing && sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+        if (ringFd >= 0) close(ringFd);
+        uring = false;
+        ranuras = NULL;
+        sqes = NULL;
+        cqRing = sqRing = NULL;
+        ringFd = -1;
+    }
+
+    // preparar: pasa tramos de la cola a ranuras libres y arma sus sqe
+    void preparar() {
+        while (!cola.empty() && !libres.empty()) {
+            int r = libres.back();
+            libres.pop_back();
+            Tramo t = cola.front();
+            cola.pop_front();
+            char* buf = ranuras + (size_t)r * TAM_RANURA;
+            if (t.escritura) memcpy(buf, t.archivo->datos.data() + t.offset, t.len);
+
+            unsigned tail = *sqTail;
+            unsigned idx = tail & *sqMask;
+            io_uring_sqe* sqe = &sqes[idx];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = t.escritura ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe->fd = t.fd;
+            sqe->off = t.offset;
+            sqe->addr = (unsigned long long)(uintptr_t)buf;
+            sqe->len = (unsigned)t.len;
+            sqe->buf_index = (unsigned short)r;
+            sqe->user_data = (unsigned long long)r;
+            sqArray[idx] = idx;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+            enVuelo[r] = t;
+            activas++;
+            sinEnviar++;
+        }
+    }
+
+    // enviar: entrega las sqe preparadas; con esperar, bloquea hasta al menos una respuesta
+    bool enviar(bool esperar) {
+        unsigned flags = esperar ? IORING_ENTER_GETEVENTS : 0;
+        if (sinEnviar == 0 && !esperar) return true;
+        for (;;) {
+            long n = syscall(__NR_io_uring_enter, ringFd, sinEnviar, esperar ? 1 : 0, flags, NULL, 0);
+            if (n >= 0) {
+                sinEnviar -= (unsigned)n;
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+            if (!esperar) return true;
+        }
+    }
+
+    // cosechar: procesa las respuestas; un tramo corto vuelve a la cola con lo que falta
+    void cosechar() {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            io_uring_cqe* cqe = &cqes[head & *cqMask];
+            int r = (int)cqe->user_data;
+            Tramo t = enVuelo[r];
+            int res = cqe->res;
+            if (res > 0 && !t.escritura) {
+                memcpy(&t.archivo->datos[t.offset], ranuras + (size_t)r * TAM_RANURA, res);
+            }
+            libres.push_back(r);
+            activas--;
+            terminarTramo(t, res);
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+#endif
+
+    EstadoArchivo* estado(Archivo* a) {
+        for (size_t i = 0; i < abiertos.size(); i++) {
+            if (abiertos[i].archivo == a) return &abiertos[i];
+        }
+        return NULL;
+    }
+
+    // terminarTramo: res son los bytes transferidos o -errno
+    void terminarTramo(const Tramo& t, long res) {
+        EstadoArchivo* e = estado(t.archivo);
+        if (res <= 0) {
+            // 0 en una lectura: el archivo se achicó desde el fstat
+            t.archivo->ok = false;
+        } else if ((size_t)res < t.len) {
+            Tramo resto = t;
+            resto.offset += res;
+            resto.len -= res;
+            cola.push_back(resto);
+            return;
+        }
+        e->pendientes--;
+    }
+
+    // encolar: abre el archivo y lo parte en tramos
+    void encolar(Archivo& a, bool escritura) {
+        int fd = escritura ? open(a.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                           : open(a.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            a.ok = false;
+            return;
+        }
+        if (!escritura) {
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                close(fd);
+                a.ok = false;
+                return;
+            }
+            a.datos.resize((size_t)st.st_size);
+            MemoryStats::instance().add(MEM_FILE, (long long)a.datos.capacity());
+        }
+        a.ok = true;
+        EstadoArchivo e = {&a, fd, 0};
+        for (size_t off = 0; off < a.datos.size(); off += TAM_RANURA) {
+            Tramo t = {&a, fd, off, std::min((size_t)TAM_RANURA, a.datos.size() - off), escritura};
+            cola.push_back(t);
+            e.pendientes++;
+        }
+        abiertos.push_back(e);
+    }
+
+    void completarPread() {
+        while (!cola.empty()) {
+            Tramo t = cola.front();
+            cola.pop_front();
+            long n = t.escritura ? pwrite(t.fd, t.archivo->datos.data() + t.offset, t.len, t.offset)
+                                 : pread(t.fd, &t.archivo->datos[t.offset], t.len, t.offset);
+            if (n < 0 && errno == EINTR) {
+                cola.push_front(t);
+                continue;
+            }
+            terminarTramo(t, n < 0 ? -errno : n);
+        }
+    }
+
+public:
+    BulkIO() : uring(false) {
+        const char* env = std::getenv("FILTER_IO");
+        bool forzarPread = env && std::string(env) == "pread";
+#ifdef BULKIO_URING
+        ringFd = -1;
+        sqRing = cqRing = NULL;
+        sqes = NULL;
+        ranuras = NULL;
+        unSoloMapeo = false;
+        if (!forzarPread) uring = iniciarUring();
+#else
+        (void)forzarPread;
+#endif
+    }
+
+    ~BulkIO() {
+        completar();
+#ifdef BULKIO_URING
+        cerrarUring();
+#endif
+    }
+
+    bool usaUring() const { return uring; }
+    const char* modo() const { return uring ? "io_uring" : "pread"; }
+
+    // leer / escribir: encolan el lote y, con io_uring, envían en seguida todo lo que
+    // entre en las ranuras; el resto sale en completar()
+    void leer(std::vector<Archivo>& lote) {
+        for (size_t i = 0; i < lote.size(); i++) encolar(lote[i], false);
+        bombear();
+    }
+    void escribir(std::vector<Archivo>& lote) {
+        for (size_t i = 0; i < lote.size(); i++) encolar(lote[i], true);
+        bombear();
+    }
+
+    // bombear: con io_uring, cosecha lo terminado y envía más tramos sin bloquear
+    void bombear() {
+#ifdef BULKIO_URING
+        if (!uring) return;
+        cosechar();
+        preparar();
+        if (!enviar(false)) uring = false;
+#endif
+    }
+
+    // completar: espera a que terminen todas las operaciones encoladas y cierra los archivos
+    void completar() {
+#ifdef BULKIO_URING
+        while (uring && (activas > 0 || !cola.empty())) {
+            cosechar();
+            preparar();
+            if (!enviar(activas > 0)) {
+                // El anillo dejó de funcionar: lo que esté en vuelo se da por perdido
+                for (size_t i = 0; i < abiertos.size(); i++) {
+                    if (abiertos[i].pendientes > 0) abiertos[i].archivo->ok = false;
+                }
+                cola.clear();
+                activas = 0;
+                break;
+            }
+        }
+#endif
+        completarPread();
+        for (size_t i = 0; i < abiertos.size(); i++) {
+            if (abiertos[i].pendientes > 0) abiertos[i].archivo->ok = false;
+            if (close(abiertos[i].fd) != 0) abiertos[i].archivo->ok = false;
+        }
+        abiertos.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "codecs.h"
+#include "deflate.h"
+
+using namespace std;
+
+static int hilosCodec() {
+    const char* env = getenv("FILTER_CODEC_THREADS");
+    int n = (env && atoi(env) > 0) ? atoi(env) : (int)thread::hardware_concurrency();
+    return max(1, n);
+}
+
+// porBandas: f(y0, y1) sobre bandas de filas de [0, filas), una por hilo
+template <class F>
+static void porBandas(int filas, F f) {
+    int hilos = min(hilosCodec(), max(1, filas / 16));
+    if (hilos == 1) {
+        f(0, filas);
+        return;
+    }
+    vector<thread> grupo;
+    int paso = (filas + hilos - 1) / hilos;
+    for (int t = 0; t < hilos; t++) {
+        int y0 = min(filas, t * paso), y1 = min(filas, y0 + paso);
+        grupo.push_back(thread([&f, y0, y1]() { f(y0, y1); }));
+    }
+    for (size_t t = 0; t < grupo.size(); t++) grupo[t].join();
+}
+
+static unsigned leerBE(const unsigned char* p, int bytes) {
+    unsigned v = 0;
+    for (int i = 0; i < bytes; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+static void ponerBE(string& out, unsigned v, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) out += (char)((v >> (8 * i)) & 0xFF);
+}
+
+// escalar: v de [0, de] a [0, a] redondeando; con a >= de la vuelta es exacta
+static inline int escalar(int v, int de, int a) {
+    return (int)(((long long)clampValue(v, 0, de) * a + de / 2) / de);
+}
+
+// ---------------------------------------------------------------- PNG
+
+namespace {
+
+struct TablaCrc {
+    unsigned long t[256];
+    TablaCrc() {
+        for (unsigned long i = 0; i < 256; i++) {
+            unsigned long c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+    }
+};
+
+}  // namespace
+
+static unsigned long crc32(const unsigned char* p, size_t n, unsigned long crc = 0) {
+    static const TablaCrc tabla;
+    crc ^= 0xFFFFFFFFUL;
+    for (size_t i = 0; i < n; i++) crc = tabla.t[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+static void bloquePng(string& out, const char* tipo, const unsigned char* datos, size_t n) {
+    ponerBE(out, (unsigned)n, 4);
+    size_t inicio = out.size();
+    out.append(tipo, 4);
+    out.append((const char*)datos, n);
+    ponerBE(out, (unsigned)crc32((const unsigned char*)out.data() + inicio, n + 4), 4);
+}
+
+static inline int paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+// filtrarFila: fila con el filtro tipo (0 a 4) de PNG; previa es la fila cruda de arriba
+static void filtrarFila(int tipo, const unsigned char* fila, const unsigned char* previa, int bytes, int bpp,
+                        unsigned char* dst) {
+    for (int i = 0; i < bytes; i++) {
+        int a = i >= bpp ? fila[i - bpp] : 0, b = previa[i], c = i >= bpp ? previa[i - bpp] : 0;
+        int pred = tipo == 1 ? a : tipo == 2 ? b : tipo == 3 ? (a + b) / 2 : tipo == 4 ? paeth(a, b, c) : 0;
+        dst[i] = (unsigned char)(fila[i] - pred);
+    }
+}
+
+void PngCodec::encode(const Image& img, string& out) {
+    int w = img.width, h = img.height, ch = img.channels();
+    int bits = img.maxColor < 256 ? 8 : 16;
+    int completo = bits == 8 ? 255 : 65535;
+    bool escalado = img.maxColor != completo;
+    int bpp = ch * bits / 8;
+    size_t bytesFila = (size_t)w * bpp;
+
+    // Cada banda arma sus filas crudas y las filtra; la fila de arriba de la primera fila de
+    // la banda se arma aparte para no depender de la banda anterior
+    vector<unsigned char> filtrado((size_t)h * (bytesFila + 1));
+    MemoryStats::instance().add(MEM_FILE, vectorBytes(filtrado));
+    porBandas(h, [&](int y0, int y1) {
+        vector<unsigned char> previa(bytesFila, 0), actual(bytesFila), prueba(bytesFila);
+        auto cruda = [&](int y, unsigned char* dst) {
+            const int* fila = img.row(y);
+            for (int i = 0; i < w * ch; i++) {
+                int v = escalado ? escalar(fila[i], img.maxColor, completo) : clampValue(fila[i], 0, completo);
+                if (bits == 8) {
+                    dst[i] = (unsigned char)v;
+                } else {
+                    dst[2 * i] = (unsigned char)(v >> 8);
+                    dst[2 * i + 1] = (unsigned char)v;
+                }
+            }
+        };
+        if (y0 > 0) cruda(y0 - 1, previa.data());
+        for (int y = y0; y < y1; y++) {
+            cruda(y, actual.data());
+            unsigned char* dst = &filtrado[(size_t)y * (bytesFila + 1)];
+            long long mejor = -1;
+            for (int tipo = 0; tipo < 5; tipo++) {
+                filtrarFila(tipo, actual.data(), previa.data(), (int)bytesFila, bpp, prueba.data());
+                long long suma = 0;
+                for (size_t i = 0; i < bytesFila; i++) suma += abs((int)(signed char)prueba[i]);
+                if (mejor < 0 || suma < mejor) {
+                    mejor = suma;
+                    dst[0] = (unsigned char)tipo;
+                    copy(prueba.begin(), prueba.end(), dst + 1);
+                }
+            }
+            swap(previa, actual);
+        }
+    });
+
+    string idat;
+    zlibCompress(filtrado.data(), filtrado.size(), idat, hilosCodec());
+
+    out.assign("\x89PNG\r\n\x1a\n", 8);
+    unsigned char ihdr[13];
+    for (int i = 0; i < 4; i++) {
+        ihdr[i] = (unsigned char)(w >> (24 - 8 * i));
+        ihdr[4 + i] = (unsigned char)(h >> (24 - 8 * i));
+    }
+    ihdr[8] = (unsigned char)bits;
+    ihdr[9] = ch == 3 ? 2 : 0;
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+    bloquePng(out, "IHDR", ihdr, 13);
+    if (escalado) {
+        unsigned char m[2] = {(unsigned char)(img.maxColor >> 8), (unsigned char)img.maxColor};
+        bloquePng(out, "pnMx", m, 2);
+    }
+    // IDAT en bloques de 1 MB
+    for (size_t i = 0; i < idat.size(); i += 1 << 20) {
+        bloquePng(out, "IDAT", (const unsigned char*)idat.data() + i, min(idat.size() - i, (size_t)1 << 20));
+    }
+    bloquePng(out, "IEND", NULL, 0);
+    MemoryStats::instance().add(MEM_FILE, (long long)out.capacity());
+}
+
+bool PngCodec::decode(const string& data, const string& name, Image& img, int guard) {
+    const unsigned char* p = (const unsigned char*)data.data();
+    size_t pos = 8;
+    int w = 0, h = 0, depth = 0, tipo = -1, maxPnm = 0;
+    vector<unsigned char> paleta;
+    string idat;
+    bool fin = false;
+    while (!fin) {
+        if (pos + 12 > data.size()) {
+            cerr << "PNG incompleto: " << name << "\n";
+            return false;
+        }
+        size_t len = leerBE(p + pos, 4);
+        if (pos + 12 + len > data.size() || crc32(p + pos + 4, len + 4) != leerBE(p + pos + 8 + len, 4)) {
+            cerr << "PNG dañado: " << name << "\n";
+            return false;
+        }
+        string bloque((const char*)p + pos + 4, 4);
+        const unsigned char* d = p + pos + 8;
+        if (bloque == "IHDR" && len == 13) {
+            w = (int)leerBE(d, 4);
+            h = (int)leerBE(d + 4, 4);
+            depth = d[8];
+            tipo = d[9];
+            if (d[12] != 0) {
+                cerr << "PNG entrelazado (Adam7) no soportado: " << name << "\n";
+                return false;
+            }
+        } else if (bloque == "PLTE") {
+            paleta.assign(d, d + len);
+        } else if (bloque == "pnMx" && len == 2) {
+            maxPnm = (int)leerBE(d, 2);
+        } else if (bloque == "IDAT") {
+            idat.append((const char*)d, len);
+        } else if (bloque == "IEND") {
+            fin = true;
+        }
+        pos += 12 + len;
+    }
+
+    // Muestras por píxel en el archivo y profundidades válidas de cada tipo de color
+    int spp = tipo == 0 ? 1 : tipo == 2 ? 3 : tipo == 3 ? 1 : tipo == 4 ? 2 : tipo == 6 ? 4 : 0;
+    bool valido = w > 0 && h > 0 && spp > 0 &&
+                  (depth == 8 || (depth == 16 && tipo != 3) ||
+                   ((depth == 1 || depth == 2 || depth == 4) && (tipo == 0 || tipo == 3)));
+    if (!valido || (tipo == 3 && paleta.size() < 3)) {
+        cerr << "PNG no soportado: " << name << "\n";
+        return false;
+    }
+    int bitsPixel = spp * depth;
+    size_t bytesFila = ((size_t)w * bitsPixel + 7) / 8;
+    int bpp = max(1, bitsPixel / 8);
+    // Antes de descomprimir: la imagen tiene que entrar en Image y el flujo filtrado no
+    // puede ser más grande de lo que deflate saca de idat (a lo sumo 1032 a 1)
+    bool color = tipo == 2 || tipo == 3 || tipo == 6;
+    if (!Image::sizeFits(color ? "P6" : "P5", w, h, guard) || bytesFila + 1 > SIZE_MAX / (size_t)h ||
+        ((size_t)h * (bytesFila + 1)) / 1032 > idat.size()) {
+        cerr << "Dimensiones no soportadas: " << name << " (" << w << "x" << h << ")\n";
+        return false;
+    }
+    vector<unsigned char> crudo;
+    if (!zlibDecompress((const unsigned char*)idat.data(), idat.size(), crudo, (size_t)h * (bytesFila + 1))) {
+        cerr << "Datos comprimidos inválidos en " << name << "\n";
+        return false;
+    }
+    string().swap(idat);
+    MemoryStats::instance().add(MEM_FILE, vectorBytes(crudo));
+
+    // Quitar los filtros: cada fila depende de la de arriba, va en orden
+    for (int y = 0; y < h; y++) {
+        unsigned char* fila = &crudo[(size_t)y * (bytesFila + 1)];
+        const unsigned char* previa = y > 0 ? fila - (bytesFila + 1) + 1 : NULL;
+        int f = fila[0];
+        fila++;
+        if (f > 4) {
+            cerr << "Filtro de fila inválido en " << name << "\n";
+            return false;
+        }
+        for (size_t i = 0; i < bytesFila; i++) {
+            int a = i >= (size_t)bpp ? fila[i - bpp] : 0;
+            int b = previa ? previa[i] : 0;
+            int c = (previa && i >= (size_t)bpp) ? previa[i - bpp] : 0;
+            int pred = f == 1 ? a : f == 2 ? b : f == 3 ? (a + b) / 2 : f == 4 ? paeth(a, b, c) : 0;
+            fila[i] = (unsigned char)(fila[i] + pred);
+        }
+    }
+
+    int completo = tipo == 3 ? 255 : (1 << depth) - 1;
+    int maxC = (maxPnm > 0 && maxPnm <= completo && depth >= 8) ? maxPnm : completo;
+    if (!img.allocate(color ? "P6" : "P5", w, h, maxC, guard)) {
+        cerr << "Dimensiones no soportadas: " << name << " (" << w << "x" << h << ")\n";
+        return false;
+    }
+    MemoryStats::instance().add(MEM_INPUT, vectorBytes(img.pixels));
+    int canales = color ? 3 : 1;
+    size_t colores = paleta.size() / 3;
+    atomic<bool> ok(true);
+    porBandas(h, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            const unsigned char* fila = &crudo[(size_t)y * (bytesFila + 1) + 1];
+            int* dst = img.row(y);
+            for (int x = 0; x < w; x++) {
+                for (int c = 0; c < canales; c++) {
+                    int v;
+                    if (depth < 8) {
+                        size_t bit = (size_t)x * depth;
+                        v = (fila[bit / 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1);
+                        if (tipo == 3) {
+                            if ((size_t)v >= colores) ok = false;
+                            v = (size_t)v < colores ? paleta[3 * v + c] : 0;
+                        }
+                    } else if (tipo == 3) {
+                        v = fila[x];
+                        if ((size_t)v >= colores) ok = false;
+                        v = (size_t)v < colores ? paleta[3 * v + c] : 0;
+                    } else {
+                        size_t k = (size_t)x * spp + c;
+                        v = depth == 8 ? fila[k] : (fila[2 * k] << 8) | fila[2 * k + 1];
+                    }
+                    dst[x * canales + c] = maxC == completo ? v : escalar(v, completo, maxC);
+                }
+            }
+        }
+    });
+    if (!ok) cerr << "Índice de paleta fuera de rango en " << name << "\n";
+    return ok;
+}
+
+// ---------------------------------------------------------------- QOI
+
+namespace {
+
+struct Pixel {
+    unsigned char r, g, b, a;
+    bool operator==(const Pixel& o) const { return r == o.r && g == o.g && b == o.b && a == o.a; }
+    int hash() const { return (r * 3 + g * 5 + b * 7 + a * 11) % 64; }
+};
+
+}  // namespace
+
+bool QoiCodec::encode(const Image& img, string& out) {
+    if (img.maxColor > 255) {
+        cerr << "QOI sólo guarda 8 bits (maxColor " << img.maxColor << "); usar .png\n";
+        return false;
+    }
+    int w = img.width, h = img.height, ch = img.channels();
+    out.assign("qoif", 4);
+    ponerBE(out, (unsigned)w, 4);
+    ponerBE(out, (unsigned)h, 4);
+    out += (char)3;
+    out += (char)0;
+    out.reserve(out.size() + (size_t)w * h * 4 + 8);
+    MemoryStats::instance().add(MEM_FILE, (long long)out.capacity());
+
+    Pixel indice[64];
+    memset(indice, 0, sizeof(indice));
+    Pixel previo = {0, 0, 0, 255};
+    int racha = 0;
+    for (int y = 0; y < h; y++) {
+        const int* fila = img.row(y);
+        for (int x = 0; x < w; x++) {
+            unsigned char m[3];
+            for (int c = 0; c < 3; c++) {
+                int v = fila[x * ch + (ch == 3 ? c : 0)];
+                m[c] = (unsigned char)(img.maxColor == 255 ? clampValue(v, 0, 255) : escalar(v, img.maxColor, 255));
+            }
+            Pixel px = {m[0], m[1], m[2], 255};
+            bool ultimo = y == h - 1 && x == w - 1;
+            if (px == previo) {
+                racha++;
+                if (racha == 62 || ultimo) {
+                    out += (char)(0xC0 | (racha - 1));
+                    racha = 0;
+                }
+                continue;
+            }
+            if (racha > 0) {
+                out += (char)(0xC0 | (racha - 1));
+                racha = 0;
+            }
+            int hsh = px.hash();
+            if (indice[hsh] == px) {
+                out += (char)hsh;
+            } else {
+                indice[hsh] = px;
+                signed char vr = (signed char)(px.r - previo.r), vg = (signed char)(px.g - previo.g);
+                signed char vb = (signed char)(px.b - previo.b);
+                int vgr = vr - vg, vgb = vb - vg;
+                if (vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 && vb <= 1) {
+                    out += (char)(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                } else if (vg >= -32 && vg <= 31 && vgr >= -8 && vgr <= 7 && vgb >= -8 && vgb <= 7) {
+                    out += (char)(0x80 | (vg + 32));
+                    out += (char)((vgr + 8) << 4 | (vgb + 8));
+                } else {
+                    out += (char)0xFE;
+                    out += (char)px.r;
+                    out += (char)px.g;
+                    out += (char)px.b;
+                }
+            }
+            previo = px;
+        }
+    }
+    out.append(7, '\0');
+    out += (char)1;
+    return true;
+}
+
+bool QoiCodec::decode(const string& data, const string& name, Image& img, int guard) {
+    const unsigned char* p = (const unsigned char*)data.data();
+    if (data.size() < 14 + 8) {
+        cerr << "QOI incompleto: " << name << "\n";
+        return false;
+    }
+    int w = (int)leerBE(p + 4, 4), h = (int)leerBE(p + 8, 4), canales = p[12];
+    if (w <= 0 || h <= 0 || (canales != 3 && canales != 4)) {
+        cerr << "Cabecera QOI inválida: " << name << "\n";
+        return false;
+    }
+    // Cada byte de datos da a lo sumo 62 píxeles (una racha): un w x h que no puede salir
+    // de data.size() se rechaza antes de reservar la imagen
+    if ((unsigned long long)w * h > (unsigned long long)(data.size() - 22) * 62) {
+        cerr << "Dimensiones no soportadas: " << name << " (" << w << "x" << h << ")\n";
+        return false;
+    }
+    if (!img.allocate("P6", w, h, 255, guard)) {
+        cerr << "Dimensiones no soportadas: " << name << " (" << w << "x" << h << ")\n";
+        return false;
+    }
+    MemoryStats::instance().add(MEM_INPUT, vectorBytes(img.pixels));
+
+    Pixel indice[64];
+    memset(indice, 0, sizeof(indice));
+    Pixel px = {0, 0, 0, 255};
+    size_t pos = 14, fin = data.size() - 8;
+    int racha = 0;
+    for (int y = 0; y < h; y++) {
+        int* dst = img.row(y);
+        for (int x = 0; x < w; x++) {
+            if (racha > 0) {
+                racha--;
+            } else {
+                // Ninguna operación lee más de 5 bytes y después de fin siguen los 8 del
+                // marcador final, así que alcanza con comprobar el primero
+                if (pos >= fin) {
+                    cerr << "QOI incompleto: " << name << "\n";
+                    return false;
+                }
+                int b = p[pos++];
+                if (b == 0xFE) {
+                    px.r = p[pos];
+                    px.g = p[pos + 1];
+                    px.b = p[pos + 2];
+                    pos += 3;
+                } else if (b == 0xFF) {
+                    px.r = p[pos];
+                    px.g = p[pos + 1];
+                    px.b = p[pos + 2];
+                    px.a = p[pos + 3];
+                    pos += 4;
+                } else if ((b & 0xC0) == 0x00) {
+                    px = indice[b];
+                } else if ((b & 0xC0) == 0x40) {
+                    px.r += ((b >> 4) & 3) - 2;
+                    px.g += ((b >> 2) & 3) - 2;
+                    px.b += (b & 3) - 2;
+                } else if ((b & 0xC0) == 0x80) {
+                    int vg = (b & 0x3F) - 32, b2 = p[pos++];
+                    px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+                    px.g += vg;
+                    px.b += vg - 8 + (b2 & 0x0F);
+                } else {
+                    racha = b & 0x3F;
+                }
+                indice[px.hash()] = px;
+            }
+            dst[3 * x] = px.r;
+            dst[3 * x + 1] = px.g;
+            dst[3 * x + 2] = px.b;
+        }
+    }
+    return true;
+}
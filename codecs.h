@@ -0,0 +1,43 @@
+#ifndef CODECS_H
+#define CODECS_H
+
+// codecs.h: PNG y QOI sin bibliotecas externas, para leer y escribir los archivos reales sin
+// convertirlos antes a PNM. Image::load los reconoce por la firma y Image::save por la
+// extensión (.png, .qoi), así que todos los backends y el modo batch los aceptan.
+//
+// PNG: sin entrelazado; grises, RGB y paleta de 1 a 16 bits, con alfa que se descarta. Se
+// escribe en 8 o 16 bits con el filtro de fila de menor suma absoluta y el deflate de
+// deflate.h, comprimido en bandas paralelas. Si maxColor no es 255 ni 65535 las muestras se
+// escalan al rango completo y el maxColor original va en el bloque privado pnMx, así la
+// vuelta a PNM da exactamente las mismas muestras.
+// QOI: sólo 8 bits y siempre RGB (el formato no tiene grises: una imagen gris vuelve como
+// P6 con los tres canales iguales); con maxColor < 255 las muestras se escalan a 255. El
+// flujo depende del píxel anterior, así que no se puede partir entre hilos.
+//
+// Hilos: FILTER_CODEC_THREADS (por defecto los del procesador).
+
+#include <string>
+#include "image.h"
+
+class PngCodec {
+public:
+    static bool isPng(const std::string& data) { return data.compare(0, 8, "\x89PNG\r\n\x1a\n") == 0; }
+
+    // decode: la imagen como P5 (grises) o P6 con guard píxeles de borde (Image::allocate)
+    static bool decode(const std::string& data, const std::string& name, Image& img, int guard = 0);
+
+    // encode: el contenido del archivo .png de img
+    static void encode(const Image& img, std::string& out);
+};
+
+class QoiCodec {
+public:
+    static bool isQoi(const std::string& data) { return data.compare(0, 4, "qoif") == 0; }
+
+    static bool decode(const std::string& data, const std::string& name, Image& img, int guard = 0);
+
+    // encode: false si maxColor no entra en 8 bits
+    static bool encode(const Image& img, std::string& out);
+};
+
+#endif
@@ -0,0 +1,532 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <thread>
+#include "deflate.h"
+
+using namespace std;
+
+static const size_t MIN_BANDA = 256 << 10;
+static const int VENTANA = 32768;
+static const int MAX_CADENA = 32;        // candidatos que se prueban por posición
+static const size_t FICHAS_BLOQUE = 32768;
+
+static const unsigned short BASE_LONG[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                             35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char EXTRA_LONG[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                             3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const unsigned short BASE_DIST[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                             193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                             6145, 8193, 12289, 16385, 24577};
+static const unsigned char EXTRA_DIST[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                             7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// Orden en que se escriben las longitudes del código de longitudes
+static const unsigned char ORDEN[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static unsigned long adler32(const unsigned char* p, size_t n) {
+    unsigned long a = 1, b = 0;
+    while (n > 0) {
+        size_t k = min(n, (size_t)5552);   // lo más que se suma sin desbordar antes del módulo
+        n -= k;
+        while (k-- > 0) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+static unsigned invertir(unsigned codigo, int len) {
+    unsigned r = 0;
+    for (int i = 0; i < len; i++, codigo >>= 1) r = (r << 1) | (codigo & 1);
+    return r;
+}
+
+// codigosCanonicos: códigos de Huffman de deflate a partir de las longitudes, ya invertidos
+// para escribirlos desde el bit menos significativo
+static void codigosCanonicos(const vector<unsigned char>& len, vector<unsigned>& codigos) {
+    int cuenta[16] = {0}, siguiente[16];
+    for (size_t i = 0; i < len.size(); i++) cuenta[len[i]]++;
+    cuenta[0] = 0;
+    int codigo = 0;
+    for (int l = 1; l < 16; l++) {
+        codigo = (codigo + cuenta[l - 1]) << 1;
+        siguiente[l] = codigo;
+    }
+    codigos.assign(len.size(), 0);
+    for (size_t i = 0; i < len.size(); i++) {
+        if (len[i]) codigos[i] = invertir(siguiente[len[i]]++, len[i]);
+    }
+}
+
+// ---------------------------------------------------------------- descompresión
+
+namespace {
+
+struct Entrada {
+    const unsigned char* p;
+    size_t n, pos;
+    unsigned long long buf;
+    int cnt;
+    bool error;
+
+    void llenar() {
+        while (cnt <= 56 && pos < n) {
+            buf |= (unsigned long long)p[pos++] << cnt;
+            cnt += 8;
+        }
+    }
+    unsigned bits(int k) {
+        if (k == 0) return 0;
+        llenar();
+        if (cnt < k) {
+            error = true;
+            return 0;
+        }
+        unsigned v = (unsigned)(buf & ((1ull << k) - 1));
+        buf >>= k;
+        cnt -= k;
+        return v;
+    }
+};
+
+// Tabla: decodificación de un código de Huffman con una sola consulta de maxLen bits;
+// cada entrada es símbolo << 4 | longitud, 0 si el código no existe
+struct Tabla {
+    vector<unsigned short> t;
+    int maxLen;
+
+    bool construir(const unsigned char* len, int n) {
+        vector<unsigned char> l(len, len + n);
+        int cuenta[16] = {0};
+        for (int i = 0; i < n; i++) cuenta[l[i]]++;
+        cuenta[0] = 0;
+        int libre = 1;
+        maxLen = 1;
+        for (int b = 1; b < 16; b++) {
+            libre = (libre << 1) - cuenta[b];
+            if (libre < 0) return false;     // más códigos de los que caben
+            if (cuenta[b]) maxLen = b;
+        }
+        vector<unsigned> codigos;
+        codigosCanonicos(l, codigos);
+        t.assign((size_t)1 << maxLen, 0);
+        for (int s = 0; s < n; s++) {
+            if (!l[s]) continue;
+            for (unsigned r = codigos[s]; r < t.size(); r += 1u << l[s]) t[r] = (unsigned short)(s << 4 | l[s]);
+        }
+        return true;
+    }
+
+    int decodificar(Entrada& in) const {
+        in.llenar();
+        unsigned e = t[in.buf & (t.size() - 1)];
+        int l = e & 15;
+        if (e == 0 || l > in.cnt) {
+            in.error = true;
+            return -1;
+        }
+        in.buf >>= l;
+        in.cnt -= l;
+        return (int)(e >> 4);
+    }
+};
+
+}  // namespace
+
+// crecer: agranda out (al doble, sin pasar de limite) para que entren necesario bytes
+static bool crecer(vector<unsigned char>& out, size_t necesario, size_t limite) {
+    if (necesario > limite) return false;
+    if (necesario > out.size()) out.resize(min(limite, max(necesario, max((size_t)65536, 2 * out.size()))));
+    return true;
+}
+
+// inflar: los bloques de deflate hasta el que tiene BFINAL. out crece a medida que llegan
+// datos y nunca pasa de limite, así un tamaño declarado enorme no se reserva de entrada
+static bool inflar(Entrada& in, vector<unsigned char>& out, size_t limite) {
+    size_t o = 0;
+    bool final = false;
+    Tabla litlen, dist;
+    while (!final) {
+        final = in.bits(1) != 0;
+        int tipo = (int)in.bits(2);
+        if (in.error) return false;
+        if (tipo == 0) {
+            // Almacenado: alinear, LEN y NLEN, y los bytes tal cual
+            in.bits(in.cnt & 7);
+            unsigned len = in.bits(16), nlen = in.bits(16);
+            if (in.error || (len ^ 0xFFFF) != nlen || !crecer(out, o + len, limite)) return false;
+            while (len > 0 && in.cnt > 0) {
+                out[o++] = (unsigned char)(in.buf & 0xFF);
+                in.buf >>= 8;
+                in.cnt -= 8;
+                len--;
+            }
+            if (in.pos + len > in.n) return false;
+            if (len > 0) memcpy(&out[o], in.p + in.pos, len);
+            in.pos += len;
+            o += len;
+            continue;
+        }
+        unsigned char longitudes[320];
+        if (tipo == 1) {
+            for (int i = 0; i < 288; i++) longitudes[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+            for (int i = 0; i < 30; i++) longitudes[288 + i] = 5;
+            litlen.construir(longitudes, 288);
+            dist.construir(longitudes + 288, 30);
+        } else if (tipo == 2) {
+            int hlit = (int)in.bits(5) + 257, hdist = (int)in.bits(5) + 1, hclen = (int)in.bits(4) + 4;
+            unsigned char lcl[19] = {0};
+            for (int i = 0; i < hclen; i++) lcl[ORDEN[i]] = (unsigned char)in.bits(3);
+            Tabla cl;
+            if (in.error || hlit > 286 || hdist > 30 || !cl.construir(lcl, 19)) return false;
+            int i = 0;
+            while (i < hlit + hdist) {
+                int s = cl.decodificar(in);
+                if (s < 0) return false;
+                if (s < 16) {
+                    longitudes[i++] = (unsigned char)s;
+                    continue;
+                }
+                int repetir, valor = 0;
+                if (s == 16) {
+                    if (i == 0) return false;
+                    valor = longitudes[i - 1];
+                    repetir = 3 + (int)in.bits(2);
+                } else if (s == 17) {
+                    repetir = 3 + (int)in.bits(3);
+                } else {
+                    repetir = 11 + (int)in.bits(7);
+                }
+                if (in.error || i + repetir > hlit + hdist) return false;
+                while (repetir-- > 0) longitudes[i++] = (unsigned char)valor;
+            }
+            if (longitudes[256] == 0 || !litlen.construir(longitudes, hlit) ||
+                !dist.construir(longitudes + hlit, hdist)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+
+        for (;;) {
+            int s = litlen.decodificar(in);
+            if (s < 0) return false;
+            if (s < 256) {
+                if (!crecer(out, o + 1, limite)) return false;
+                out[o++] = (unsigned char)s;
+                continue;
+            }
+            if (s == 256) break;
+            s -= 257;
+            if (s >= 29) return false;
+            size_t len = BASE_LONG[s] + in.bits(EXTRA_LONG[s]);
+            int d = dist.decodificar(in);
+            if (d < 0 || d >= 30) return false;
+            size_t distancia = BASE_DIST[d] + in.bits(EXTRA_DIST[d]);
+            if (in.error || distancia > o || !crecer(out, o + len, limite)) return false;
+            // Las copias pueden solaparse (distancia < len): byte por byte
+            unsigned char* dst = &out[o];
+            const unsigned char* src = dst - distancia;
+            for (size_t k = 0; k < len; k++) dst[k] = src[k];
+            o += len;
+        }
+    }
+    // Lo que quede en el búfer de bits vuelve a la entrada para leer el Adler-32
+    in.bits(in.cnt & 7);
+    in.pos -= in.cnt / 8;
+    in.buf = 0;
+    in.cnt = 0;
+    out.resize(o);
+    return o == limite;
+}
+
+bool zlibDecompress(const unsigned char* data, size_t n, vector<unsigned char>& out, size_t esperado) {
+    if (n < 6 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20)) {
+        return false;
+    }
+    out.clear();
+    Entrada in = {data, n, 2, 0, 0, false};
+    if (!inflar(in, out, esperado) || in.pos + 4 > n) return false;
+    const unsigned char* a = data + in.pos;
+    unsigned long adler = ((unsigned long)a[0] << 24) | (a[1] << 16) | (a[2] << 8) | a[3];
+    return adler == adler32(out.data(), out.size());
+}
+
+// ---------------------------------------------------------------- compresión
+
+namespace {
+
+struct Salida {
+    string& out;
+    unsigned long long buf;
+    int cnt;
+
+    explicit Salida(string& o) : out(o), buf(0), cnt(0) {}
+    void poner(unsigned v, int n) {
+        buf |= (unsigned long long)v << cnt;
+        cnt += n;
+        while (cnt >= 8) {
+            out += (char)(buf & 0xFF);
+            buf >>= 8;
+            cnt -= 8;
+        }
+    }
+    void alinear() {
+        if (cnt > 0) out += (char)(buf & 0xFF);
+        buf = 0;
+        cnt = 0;
+    }
+};
+
+// Ficha: un literal (dist == 0) o una copia de len bytes a distancia dist
+struct Ficha {
+    unsigned short len, dist;
+};
+
+struct Tablas {
+    unsigned char simLong[259];      // longitud -> código 257 + índice
+    unsigned char simDist[VENTANA + 1];
+
+    Tablas() {
+        for (int s = 0; s < 29; s++) {
+            int fin = s == 28 ? 258 : BASE_LONG[s + 1] - 1;
+            for (int l = BASE_LONG[s]; l <= fin; l++) simLong[l] = (unsigned char)s;
+        }
+        simLong[258] = 28;
+        for (int s = 0; s < 30; s++) {
+            int fin = s == 29 ? VENTANA : BASE_DIST[s + 1] - 1;
+            for (int d = BASE_DIST[s]; d <= fin; d++) simDist[d] = (unsigned char)s;
+        }
+    }
+};
+
+const Tablas& tablas() {
+    static const Tablas t;
+    return t;
+}
+
+}  // namespace
+
+// longitudesHuffman: longitudes de un código de Huffman para freq con a lo sumo limite bits.
+// Si el árbol sale más profundo se aplanan las frecuencias y se vuelve a armar. Siempre hay
+// al menos dos códigos, así el código queda completo
+static void longitudesHuffman(vector<unsigned> freq, int limite, vector<unsigned char>& len) {
+    int n = (int)freq.size();
+    int usados = 0;
+    for (int i = 0; i < n; i++) usados += freq[i] > 0;
+    for (int i = 0; i < n && usados < 2; i++) {
+        if (freq[i] == 0) {
+            freq[i] = 1;
+            usados++;
+        }
+    }
+    for (;;) {
+        typedef pair<unsigned long long, int> Nodo;
+        priority_queue<Nodo, vector<Nodo>, greater<Nodo> > cola;
+        vector<int> padre(2 * n, -1);
+        for (int i = 0; i < n; i++) if (freq[i]) cola.push(Nodo(freq[i], i));
+        int siguiente = n;
+        while (cola.size() > 1) {
+            Nodo a = cola.top();
+            cola.pop();
+            Nodo b = cola.top();
+            cola.pop();
+            padre[a.second] = padre[b.second] = siguiente;
+            cola.push(Nodo(a.first + b.first, siguiente++));
+        }
+        len.assign(n, 0);
+        int maximo = 0;
+        for (int i = 0; i < n; i++) {
+            if (!freq[i]) continue;
+            int d = 0;
+            for (int p = padre[i]; p >= 0; p = padre[p]) d++;
+            len[i] = (unsigned char)min(d, 255);
+            maximo = max(maximo, d);
+        }
+        if (maximo <= limite) return;
+        for (int i = 0; i < n; i++) if (freq[i]) freq[i] = (freq[i] + 1) / 2;
+    }
+}
+
+// bloqueDinamico: las fichas como un bloque con Huffman dinámico
+static void bloqueDinamico(Salida& s, const vector<Ficha>& fichas, bool final) {
+    const Tablas& t = tablas();
+    vector<unsigned> fLit(286, 0), fDist(30, 0);
+    for (size_t i = 0; i < fichas.size(); i++) {
+        if (fichas[i].dist == 0) {
+            fLit[fichas[i].len]++;
+        } else {
+            fLit[257 + t.simLong[fichas[i].len]]++;
+            fDist[t.simDist[fichas[i].dist]]++;
+        }
+    }
+    fLit[256] = 1;
+    vector<unsigned char> lLit, lDist;
+    longitudesHuffman(fLit, 15, lLit);
+    longitudesHuffman(fDist, 15, lDist);
+    int hlit = 286, hdist = 30;
+    while (hlit > 257 && lLit[hlit - 1] == 0) hlit--;
+    while (hdist > 1 && lDist[hdist - 1] == 0) hdist--;
+
+    // Longitudes de los dos códigos seguidas, con las repeticiones 16/17/18
+    vector<unsigned char> todas(lLit.begin(), lLit.begin() + hlit);
+    todas.insert(todas.end(), lDist.begin(), lDist.begin() + hdist);
+    vector<pair<int, int> > rle;   // (símbolo, bits extra)
+    for (size_t i = 0; i < todas.size();) {
+        int v = todas[i];
+        size_t racha = 1;
+        while (i + racha < todas.size() && todas[i + racha] == v) racha++;
+        i += racha;
+        if (v == 0) {
+            while (racha >= 11) {
+                int r = (int)min(racha, (size_t)138);
+                rle.push_back(make_pair(18, r - 11));
+                racha -= r;
+            }
+            if (racha >= 3) {
+                rle.push_back(make_pair(17, (int)racha - 3));
+                racha = 0;
+            }
+        } else {
+            rle.push_back(make_pair(v, 0));
+            racha--;
+            while (racha >= 3) {
+                int r = (int)min(racha, (size_t)6);
+                rle.push_back(make_pair(16, r - 3));
+                racha -= r;
+            }
+        }
+        while (racha-- > 0) rle.push_back(make_pair(v, 0));
+    }
+    vector<unsigned> fCl(19, 0);
+    for (size_t i = 0; i < rle.size(); i++) fCl[rle[i].first]++;
+    vector<unsigned char> lCl;
+    longitudesHuffman(fCl, 7, lCl);
+    int hclen = 19;
+    while (hclen > 4 && lCl[ORDEN[hclen - 1]] == 0) hclen--;
+
+    vector<unsigned> cLit, cDist, cCl;
+    codigosCanonicos(lLit, cLit);
+    codigosCanonicos(lDist, cDist);
+    codigosCanonicos(lCl, cCl);
+
+    s.poner(final ? 1 : 0, 1);
+    s.poner(2, 2);
+    s.poner(hlit - 257, 5);
+    s.poner(hdist - 1, 5);
+    s.poner(hclen - 4, 4);
+    for (int i = 0; i < hclen; i++) s.poner(lCl[ORDEN[i]], 3);
+    static const int EXTRA_RLE[3] = {2, 3, 7};
+    for (size_t i = 0; i < rle.size(); i++) {
+        int sim = rle[i].first;
+        s.poner(cCl[sim], lCl[sim]);
+        if (sim >= 16) s.poner(rle[i].second, EXTRA_RLE[sim - 16]);
+    }
+    for (size_t i = 0; i < fichas.size(); i++) {
+        const Ficha& f = fichas[i];
+        if (f.dist == 0) {
+            s.poner(cLit[f.len], lLit[f.len]);
+            continue;
+        }
+        int sl = t.simLong[f.len], sd = t.simDist[f.dist];
+        s.poner(cLit[257 + sl], lLit[257 + sl]);
+        s.poner(f.len - BASE_LONG[sl], EXTRA_LONG[sl]);
+        s.poner(cDist[sd], lDist[sd]);
+        s.poner(f.dist - BASE_DIST[sd], EXTRA_DIST[sd]);
+    }
+    s.poner(cLit[256], lLit[256]);
+}
+
+// comprimirBanda: deflate de p[0, n) sin ventana previa. Si no es la última banda termina
+// con un bloque almacenado vacío para quedar alineada a byte
+static void comprimirBanda(const unsigned char* p, size_t n, bool final, string& out) {
+    Salida s(out);
+    if (n == 0) {
+        // Bloque fijo vacío: sólo el fin de bloque (siete ceros)
+        s.poner(final ? 1 : 0, 1);
+        s.poner(1, 2);
+        s.poner(0, 7);
+    }
+    const int HASH = 1 << 15;
+    vector<int> cabeza(HASH, -1), previo(VENTANA, -1);
+    vector<Ficha> fichas;
+    fichas.reserve(FICHAS_BLOQUE);
+    auto hash = [&](size_t i) { return ((p[i] << 10) ^ (p[i + 1] << 5) ^ p[i + 2]) & (HASH - 1); };
+    auto insertar = [&](size_t i) {
+        if (i + 3 > n) return;
+        int h = hash(i);
+        previo[i & (VENTANA - 1)] = cabeza[h];
+        cabeza[h] = (int)i;
+    };
+    size_t i = 0;
+    while (i < n) {
+        size_t mejor = 0, mejorDist = 0;
+        if (i + 3 <= n) {
+            size_t maximo = min((size_t)258, n - i);
+            int cand = cabeza[hash(i)];
+            for (int c = 0; c < MAX_CADENA && cand >= 0 && i - cand <= (size_t)VENTANA; c++) {
+                if (p[cand + mejor] == p[i + mejor]) {
+                    size_t l = 0;
+                    while (l < maximo && p[cand + l] == p[i + l]) l++;
+                    if (l > mejor) {
+                        mejor = l;
+                        mejorDist = i - cand;
+                        if (l == maximo) break;
+                    }
+                }
+                int ant = previo[cand & (VENTANA - 1)];
+                if (ant >= cand) break;
+                cand = ant;
+            }
+        }
+        if (mejor >= 3) {
+            Ficha f = {(unsigned short)mejor, (unsigned short)mejorDist};
+            fichas.push_back(f);
+            for (size_t k = 0; k < mejor; k++) insertar(i + k);
+            i += mejor;
+        } else {
+            Ficha f = {p[i], 0};
+            fichas.push_back(f);
+            insertar(i);
+            i++;
+        }
+        if (fichas.size() >= FICHAS_BLOQUE || i >= n) {
+            bloqueDinamico(s, fichas, final && i >= n);
+            fichas.clear();
+        }
+    }
+    if (!final) {
+        s.poner(0, 3);
+        s.alinear();
+        out += string("\x00\x00\xFF\xFF", 4);
+    } else {
+        s.alinear();
+    }
+}
+
+void zlibCompress(const unsigned char* data, size_t n, string& out, int hilos) {
+    size_t bandas = max((size_t)1, min((size_t)max(hilos, 1), n / MIN_BANDA));
+    vector<string> partes(bandas);
+    vector<thread> grupo;
+    size_t paso = (n + bandas - 1) / bandas;
+    for (size_t b = 0; b < bandas; b++) {
+        size_t i0 = min(n, b * paso), i1 = min(n, i0 + paso);
+        bool final = b + 1 == bandas;
+        if (bandas == 1) {
+            comprimirBanda(data + i0, i1 - i0, final, partes[b]);
+        } else {
+            grupo.push_back(thread(comprimirBanda, data + i0, i1 - i0, final, ref(partes[b])));
+        }
+    }
+    unsigned long adler = adler32(data, n);
+    for (size_t t = 0; t < grupo.size(); t++) grupo[t].join();
+
+    out += (char)0x78;
+    out += (char)0x9C;
+    for (size_t b = 0; b < bandas; b++) out += partes[b];
+    for (int k = 3; k >= 0; k--) out += (char)((adler >> (8 * k)) & 0xFF);
+}
@@ -0,0 +1,24 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+// deflate.h: flujo zlib (RFC 1950/1951) propio, para PNG (codecs.h) sin depender de zlib.
+//
+// Compresión: LZ77 con cadenas de hash y bloques con Huffman dinámico. La entrada se parte
+// en bandas que se comprimen en hilos distintos; cada banda (menos la última) termina con
+// un bloque almacenado vacío, que deja el flujo alineado a byte, así las bandas se pegan una
+// detrás de otra (como pigz). Cada banda pierde la ventana de la anterior, por eso no se
+// parte en trozos de menos de MIN_BANDA bytes.
+// Descompresión: bloques almacenados, fijos y dinámicos; es secuencial por naturaleza.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// zlibCompress: data comprimido en formato zlib al final de out, con hasta hilos bandas
+void zlibCompress(const unsigned char* data, size_t n, std::string& out, int hilos = 1);
+
+// zlibDecompress: out pasa a tener el contenido descomprimido; false si el flujo está
+// dañado o no produce exactamente esperado bytes
+bool zlibDecompress(const unsigned char* data, size_t n, std::vector<unsigned char>& out, size_t esperado);
+
+#endif
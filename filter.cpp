@@ -2,116 +2,264 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <map>
 #include <sstream>
 #include <algorithm>
 #include <memory>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <atomic>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "image.h"
+#include "perfcounters.h"
+#include "writer.h"
+#include "bulkio.h"
+#include "streamio.h"
 
 using namespace std;
 
-// clampValue: asegura que un valor entero se encuentre dentro de un rango [minVal, maxVal].
-// Esto se usa para evitar que los valores de los píxeles se salgan del rango válido.
-inline int clampValue(int val, int minVal, int maxVal) {
-    if (val < minVal) return minVal;
-    if (val > maxVal) return maxVal;
-    return val;
-}
-// La clase Image representa una imagen en memoria.
-// Contiene sus metadatos (tipo P2/P3, ancho, alto, valor máximo de color) y los píxeles.
-class Image {
+// Clase padre Filter
+// Los filtros trabajan sobre vistas (ImageView): la imagen completa, una banda o un bloque
+// se procesan igual y sin copias. La versión con Image reserva la salida y llama a la de
+// vistas con la imagen completa.
+class Filter {
     public:
-        string magic;        
-        int width, height;   
-        int maxColor;        
-        vector<int> pixels;
-
-        // load: carga una imagen desde un archivo .pgm o .ppm en memoria
-        bool load(const string& filename) {
-            ifstream in(filename.c_str());
-            if (!in.is_open()) {
-                cerr << "Error abriendo archivo: " << filename << "\n";
-                return false;
-            }
-            in >> magic >> width >> height >> maxColor;
-
-            int pixelCount;
-            if (magic == "P3") {
-                pixelCount = width * height * 3;
-            } else {
-                pixelCount = width * height;
-            }
-            pixels.resize(pixelCount);
+        // aplicar: función virtual pura que cada filtro debe implementar; out tiene las
+        // mismas dimensiones que in y los canales que indique preparar
+        virtual void aplicar(ConstImageView in, ImageView out) = 0;
+        // preparar: reserva la salida; por defecto del mismo tipo y tamaño que la entrada
+        virtual void preparar(const Image& input, Image& output) {
+            output.allocate(input.magic, input.width, input.height, input.maxColor);
+        }
+        // borde: píxeles de guarda que conviene reservar en la entrada (Image::allocate)
+        virtual int borde() const { return 0; }
+        // porBandas: el resultado de una banda sólo depende de la banda y de borde() filas
+        // vecinas, así que se puede aplicar en el modo --stream
+        virtual bool porBandas() const { return true; }
+        Filter() : scratchMax(0) {}
+        virtual ~Filter() {}
 
-            for (int i = 0; i < pixelCount; i++) in >> pixels[i];
-            return true;
+        void aplicar(const Image& input, Image& output) {
+            preparar(input, output);
+            aplicar(input.view(), output.view());
+        }
+    protected:
+        // registrarScratch: temporales de una llamada a aplicar. Sólo llega a MemoryStats lo
+        // que supera la mayor llamada anterior de este filtro, así --stream y --batch, que
+        // llaman una vez por banda o por archivo, cuentan un juego de temporales y no la suma
+        void registrarScratch(long long bytes) {
+            long long previo = scratchMax.load();
+            while (bytes > previo && !scratchMax.compare_exchange_weak(previo, bytes)) {}
+            if (bytes > previo) MemoryStats::instance().add(MEM_SCRATCH, bytes - previo);
         }
+    private:
+        atomic<long long> scratchMax;
+    };
+
+// PointOps: secuencia de operaciones puntuales (gamma, brillo, contraste, niveles).
+// Como cada una depende sólo del valor del píxel, la composición se precalcula en una
+// tabla sobre [0, maxColor] y aplicarla cuesta un acceso a la tabla por muestra.
+// Sólo este backend las tiene (como filtro propio o como epílogo de ConvolutionFilter y
+// GrayConvolutionFilter). pthreads y MPI rechazan las especificaciones con "," o "+" en
+// vez de ignorar la parte que no entienden, y omp siempre corre los tres kernels fijos.
+class PointOps {
+    struct Op {
+        string tipo;
+        float a, b;
+    };
+    vector<Op> ops;
+public:
+    bool empty() const { return ops.empty(); }
 
-        // save: guarda una imagen desde memoria a un archivo .pgm o .ppm
-        bool save(const string& filename) {
-            ofstream out(filename.c_str());
-            if (!out.is_open()) {
-                cerr << "Error guardando archivo: " << filename << "\n";
-                return false;
+    // parse: agrega operaciones desde una lista separada por comas, por ejemplo
+    // "gamma:2.2,contrast:1.3". Formatos: gamma:g, brightness:b, contrast:c, levels:lo:hi
+    bool parse(const string& spec) {
+        vector<Op> nuevas;
+        stringstream lista(spec);
+        string item;
+        while (getline(lista, item, ',')) {
+            vector<string> partes;
+            stringstream campos(item);
+            string campo;
+            while (getline(campos, campo, ':')) partes.push_back(campo);
+            if (partes.empty()) return false;
+
+            Op op;
+            op.tipo = partes[0];
+            int esperados = (op.tipo == "levels") ? 2 : 1;
+            if (op.tipo != "gamma" && op.tipo != "brightness" && op.tipo != "contrast" && op.tipo != "levels") return false;
+            if ((int)partes.size() != esperados + 1) return false;
+
+            float valores[2] = {0.0f, 0.0f};
+            for (int k = 0; k < esperados; k++) {
+                char* fin = NULL;
+                valores[k] = strtof(partes[k + 1].c_str(), &fin);
+                if (fin == partes[k + 1].c_str() || *fin != '\0') return false;
             }
-            out << magic << "\n" << width << " " << height << "\n" << maxColor << "\n";
-            for (size_t i = 0; i < pixels.size(); i++) {
-                out << pixels[i] << "\n";
+            op.a = valores[0];
+            op.b = valores[1];
+            if (op.tipo == "gamma" && op.a <= 0.0f) return false;
+            if (op.tipo == "levels" && op.b <= op.a) return false;
+            nuevas.push_back(op);
+        }
+        if (nuevas.empty()) return false;
+        ops.insert(ops.end(), nuevas.begin(), nuevas.end());
+        return true;
+    }
+
+    // tabla: evalúa la composición para cada valor en [0, maxColor]
+    vector<int> tabla(int maxColor) const {
+        vector<int> lut(maxColor + 1);
+        for (int v = 0; v <= maxColor; v++) {
+            float x = (float)v;
+            for (size_t k = 0; k < ops.size(); k++) {
+                const Op& op = ops[k];
+                if (op.tipo == "gamma") {
+                    x = maxColor * pow(max(x, 0.0f) / maxColor, 1.0f / op.a);
+                } else if (op.tipo == "brightness") {
+                    x = x + op.a;
+                } else if (op.tipo == "contrast") {
+                    x = (x - maxColor / 2.0f) * op.a + maxColor / 2.0f;
+                } else {
+                    x = (x - op.a) * maxColor / (op.b - op.a);
+                }
+                x = min(max(x, 0.0f), (float)maxColor);
             }
-            return true;
+            lut[v] = clampValue((int)(x + 0.5f), 0, maxColor);
         }
-    };
+        return lut;
+    }
+};
 
-// Clase padre Filter
-class Filter {
-    public:
-        // aplicar: función virtual pura que cada filtro debe implementar
-        virtual void aplicar(const Image& input, Image& output) = 0;
-        virtual ~Filter() {}
-    };
+// aplicarTabla: out[i] = lut[clamp(in[i])] para n muestras.
+// Si el procesador tiene AVX2 busca 8 muestras a la vez con gather; la ruta se compila
+// con target("avx2") y se elige al ejecutar, así no hace falta FILTER_NATIVE. El resto,
+// y los procesadores sin AVX2, van por la ruta escalar.
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static long aplicarTablaAVX2(const int* __restrict in, int* __restrict out, long n, const int* lut, int maxColor) {
+    __m256i lo = _mm256_setzero_si256();
+    __m256i hi = _mm256_set1_epi32(maxColor);
+    long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+        v = _mm256_min_epi32(_mm256_max_epi32(v, lo), hi);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_i32gather_epi32(lut, v, 4));
+    }
+    return i;
+}
+
+static const bool tieneAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+void aplicarTabla(const int* __restrict in, int* __restrict out, long n, const int* lut, int maxColor) {
+    long i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (tieneAVX2) i = aplicarTablaAVX2(in, out, n, lut, maxColor);
+#endif
+    for (; i < n; i++) out[i] = lut[clampValue(in[i], 0, maxColor)];
+}
+
+// Filtro LutFilter: aplica una secuencia de operaciones puntuales como una sola tabla
+class LutFilter : public Filter {
+    PointOps ops;
+public:
+    LutFilter(const PointOps& o) : ops(o) {}
+
+    using Filter::aplicar;
+    void aplicar(ConstImageView in, ImageView out) {
+        vector<int> lut = ops.tabla(in.maxColor);
+        registrarScratch(vectorBytes(lut));
+        long rowSize = (long)in.width * in.channels;
+
+        #pragma omp parallel for schedule(static)
+        for (int y = 0; y < in.height; y++) {
+            aplicarTabla(in.row(y), out.row(y), rowSize, lut.data(), in.maxColor);
+        }
+    }
+};
 
 // Clase Padre ConvolutionFilter: implementa filtros de convolución
 class ConvolutionFilter : public Filter {
 protected:
     vector<vector<float> > kernel;
+    PointOps epilogo;
 public:
     ConvolutionFilter(const vector<vector<float> >& k) : kernel(k) {}
-    
-    // aplicar: aplica el kernel sobre toda la imagen
-    void aplicar(const Image& input, Image& output) {
-        output = input;
 
+    // getKernel: expone el kernel para etapas que fusionan la convolución con otra operación
+    const vector<vector<float> >& getKernel() const { return kernel; }
 
-        int channels;
-        if (input.magic == "P3") {
-            channels = 3;
-        } else {
-            channels = 1;
-        }
+    // setEpilogo: operaciones puntuales que se aplican a cada muestra al guardarla,
+    // junto con el clampValue, sin recorrer la imagen otra vez
+    void setEpilogo(const PointOps& ops) { epilogo = ops; }
+    const PointOps& getEpilogo() const { return epilogo; }
+    
+    // aplicar: aplica el kernel sobre toda la vista. Los vecinos de afuera se leen de la
+    // imagen de la que salió la vista (halo de una banda o un bloque) o del borde de
+    // guarda; si in.guard no alcanza, se tratan los bordes de la vista como bordes de la
+    // imagen y los vecinos de afuera no suman
+    using Filter::aplicar;
+    void aplicar(ConstImageView in, ImageView out) {
+        int channels = in.channels;
+        vector<int> lut;
+        if (!epilogo.empty()) lut = epilogo.tabla(in.maxColor);
+        registrarScratch(vectorBytes(lut));
 
         int kw = kernel[0].size();   
         int kh = kernel.size();      
         int half = kw / 2;           
 
-        for (int y = 0; y < input.height; y++) {
-            for (int x = 0; x < input.width; x++) {
+        // Con guarda los vecinos se leen sin comprobar límites; la suma sigue el mismo
+        // orden, así el resultado es idéntico al de la ruta con comprobaciones
+        if (in.guard >= half) {
+            for (int y = 0; y < in.height; y++) {
+                for (int x = 0; x < in.width; x++) {
+                    for (int c = 0; c < channels; c++) {
+                        float sum = 0.0f;
+                        for (int ky = -half; ky <= half; ky++) {
+                            const int* fila = in.row(y + ky) + c;
+                            for (int kx = -half; kx <= half; kx++) {
+                                sum += fila[(x + kx) * channels] * kernel[ky+half][kx+half];
+                            }
+                        }
+                        int v = clampValue((int)sum, 0, in.maxColor);
+                        out.row(y)[x * channels + c] = lut.empty() ? v : lut[v];
+                    }
+                }
+            }
+            return;
+        }
+
+        for (int y = 0; y < in.height; y++) {
+            for (int x = 0; x < in.width; x++) {
                 for (int c = 0; c < channels; c++) {
                     float sum = 0.0f;
                     for (int ky = -half; ky <= half; ky++) {
                         for (int kx = -half; kx <= half; kx++) {
                             int nx = x + kx;
                             int ny = y + ky;
-                            if (nx >= 0 && nx < input.width && ny >= 0 && ny < input.height) {
-                                int idx = (ny * input.width + nx) * channels + c;
-                                sum += input.pixels[idx] * kernel[ky+half][kx+half];
+                            if (nx >= 0 && nx < in.width && ny >= 0 && ny < in.height) {
+                                int idx = ny * in.stride + nx * channels + c;
+                                sum += in.data[idx] * kernel[ky+half][kx+half];
                             }
                         }
                     }
-                    int idx = (y * input.width + x) * channels + c;
-                    output.pixels[idx] = clampValue((int)sum, 0, input.maxColor);
+                    int idx = y * out.stride + x * channels + c;
+                    int v = clampValue((int)sum, 0, in.maxColor);
+                    out.data[idx] = lut.empty() ? v : lut[v];
                 }
             }
         }
     }
+
+    int borde() const { return kernel.size() / 2; }
 };
 
 
@@ -145,29 +293,714 @@ public:
     }) {}
 };
 
+// Estándares de luminancia soportados para la conversión a grises
+enum LumaStandard { BT601, BT709 };
+
+// Filtro GrayscaleFilter: convierte P3/P6 a P2/P5 con coeficientes en punto fijo Q15.
+// Los coeficientes suman 32768, así un blanco puro sigue siendo maxColor, y Q15 evita
+// desbordar int incluso con muestras de 16 bits (65535 * 32768 < 2^31).
+class GrayscaleFilter : public Filter {
+    int cr, cg, cb;
+public:
+    GrayscaleFilter(LumaStandard standard = BT601) {
+        if (standard == BT709) {
+            cr = 6966; cg = 23436; cb = 2366;   // 0.2126, 0.7152, 0.0722
+        } else {
+            cr = 9798; cg = 19235; cb = 3735;   // 0.299, 0.587, 0.114
+        }
+    }
+
+    // convertirFila: convierte n píxeles RGB entrelazados en n valores de luminancia.
+    // Sólo aritmética entera sobre arreglos contiguos sin alias, para que el compilador
+    // la vectorice con -O3.
+    void convertirFila(const int* __restrict rgb, int* __restrict gray, int n) const {
+        for (int i = 0; i < n; i++) {
+            gray[i] = (rgb[3*i] * cr + rgb[3*i+1] * cg + rgb[3*i+2] * cb + 16384) >> 15;
+        }
+    }
+
+    // preparar: la salida siempre es gris (P2 o P5)
+    void preparar(const Image& input, Image& output) {
+        output.allocate(input.isBinary() ? "P5" : "P2", input.width, input.height, input.maxColor);
+    }
+
+    using Filter::aplicar;
+    void aplicar(ConstImageView in, ImageView out) {
+        for (int y = 0; y < in.height; y++) {
+            if (in.channels == 3) convertirFila(in.row(y), out.row(y), in.width);
+            else copy(in.row(y), in.row(y) + in.width, out.row(y));
+        }
+    }
+};
+
+// Filtro GrayConvolutionFilter: conversión a grises fusionada con una convolución.
+// Convierte cada fila de entrada justo antes de necesitarla y guarda sólo las filas de
+// luminancia que cubre el kernel en un buffer circular, así la salida gris filtrada sale
+// de la imagen a color en una sola pasada, sin imagen gris intermedia.
+// El orden de la suma es el mismo de ConvolutionFilter, el resultado es idéntico a
+// aplicar GrayscaleFilter y luego la convolución.
+class GrayConvolutionFilter : public Filter {
+    GrayscaleFilter gray;
+    ConvolutionFilter* conv;
+public:
+    GrayConvolutionFilter(LumaStandard standard, ConvolutionFilter* c) : gray(standard), conv(c) {}
+    ~GrayConvolutionFilter() { delete conv; }
+
+    void preparar(const Image& input, Image& output) { gray.preparar(input, output); }
+    int borde() const { return conv->borde(); }
+
+    // aplicar: si la vista tiene al menos half filas de guarda (filas vecinas de una banda,
+    // o ceros en el borde de Image) se usan como vecinos; si no, los bordes de la vista se
+    // tratan como bordes de la imagen
+    using Filter::aplicar;
+    void aplicar(ConstImageView in, ImageView out) {
+        const vector<vector<float> >& kernel = conv->getKernel();
+        int w = in.width;
+        int h = in.height;
+        int channels = in.channels;
+        int half = kernel[0].size() / 2;
+        int rows = 2 * half + 1;
+        vector<int> lut;
+        if (!conv->getEpilogo().empty()) lut = conv->getEpilogo().tabla(in.maxColor);
+
+        // La fila de luminancia y vive en la posición y % rows del buffer circular
+        int y0 = (in.guard >= half) ? -half : 0;
+        int y1 = (in.guard >= half) ? h + half : h;
+
+        PixelBuffer ring(rows * w);
+        registrarScratch(vectorBytes(lut) + vectorBytes(ring));
+        auto fila = [&](int y) { return &ring[((y % rows + rows) % rows) * w]; };
+        auto cargar = [&](int y) {
+            if (channels == 3) gray.convertirFila(in.row(y), fila(y), w);
+            else copy(in.row(y), in.row(y) + w, fila(y));
+        };
+
+        for (int y = y0; y < half && y < y1; y++) cargar(y);
+
+        for (int y = 0; y < h; y++) {
+            if (y + half < y1) cargar(y + half);
+            for (int x = 0; x < w; x++) {
+                float sum = 0.0f;
+                for (int ky = -half; ky <= half; ky++) {
+                    for (int kx = -half; kx <= half; kx++) {
+                        int nx = x + kx;
+                        int ny = y + ky;
+                        if (nx >= 0 && nx < w && ny >= y0 && ny < y1) {
+                            sum += fila(ny)[nx] * kernel[ky+half][kx+half];
+                        }
+                    }
+                }
+                int v = clampValue((int)sum, 0, in.maxColor);
+                out.row(y)[x] = lut.empty() ? v : lut[v];
+            }
+        }
+    }
+};
+
+// calcularHistograma: cuenta cuántas muestras hay de cada valor en cada canal.
+// El resultado tiene channels * (maxColor + 1) cubetas, el canal c empieza en c * (maxColor + 1).
+// Con OpenMP cada hilo llena un histograma privado y la reducción los suma al final,
+// así no hay escrituras compartidas sobre las mismas cubetas.
+vector<long long> calcularHistograma(ConstImageView img) {
+    int channels = img.channels;
+    int bins = img.maxColor + 1;
+    vector<long long> hist((size_t)channels * bins, 0);
+    long long* h = hist.data();
+
+    #pragma omp parallel for schedule(static) reduction(+: h[:channels * bins])
+    for (int y = 0; y < img.height; y++) {
+        const int* p = img.row(y);
+        for (int i = 0; i < img.width; i++) {
+            for (int c = 0; c < channels; c++) {
+                h[c * bins + clampValue(p[i * channels + c], 0, img.maxColor)]++;
+            }
+        }
+    }
+    return hist;
+}
+
+// aplicarLUT: reemplaza cada muestra por lut[c * (maxColor + 1) + valor], por bandas de filas
+void aplicarLUT(ConstImageView input, ImageView output, const vector<int>& lut) {
+    int channels = input.channels;
+    int bins = input.maxColor + 1;
+    int rowSize = input.width * channels;
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < input.height; y++) {
+        const int* in = input.row(y);
+        int* out = output.row(y);
+        for (int i = 0; i < rowSize; i++) {
+            out[i] = lut[(i % channels) * bins + clampValue(in[i], 0, input.maxColor)];
+        }
+    }
+}
+
+// Filtro EqualizeFilter: ecualización global del histograma.
+// En P3/P6 cada canal se ecualiza por separado.
+class EqualizeFilter : public Filter {
+public:
+    bool porBandas() const { return false; }   // necesita el histograma de toda la imagen
+
+    using Filter::aplicar;
+    void aplicar(ConstImageView input, ImageView output) {
+        int channels = input.channels;
+        int bins = input.maxColor + 1;
+        long long total = (long long)input.width * input.height;
+        vector<long long> hist = calcularHistograma(input);
+        vector<int> lut((size_t)channels * bins);
+        registrarScratch(vectorBytes(hist) + vectorBytes(lut));
+
+        for (int c = 0; c < channels; c++) {
+            const long long* h = &hist[c * bins];
+            long long cdfMin = 0;
+            for (int v = 0; v < bins && cdfMin == 0; v++) cdfMin = h[v];
+
+            long long cdf = 0;
+            for (int v = 0; v < bins; v++) {
+                cdf += h[v];
+                if (total == cdfMin) {
+                    lut[c * bins + v] = v;  // imagen constante: no hay nada que ecualizar
+                } else {
+                    long long num = max(cdf - cdfMin, 0LL) * input.maxColor;
+                    lut[c * bins + v] = (int)((num + (total - cdfMin) / 2) / (total - cdfMin));
+                }
+            }
+        }
+        aplicarLUT(input, output, lut);
+    }
+};
+
+// Filtro ClaheFilter: ecualización adaptativa con límite de contraste (CLAHE).
+// Divide la imagen en tilesX x tilesY bloques, ecualiza cada bloque con su histograma
+// recortado a clipLimit veces el promedio por cubeta, y mezcla los mapeos de los cuatro
+// bloques vecinos con interpolación bilineal para que no se noten los bordes.
+class ClaheFilter : public Filter {
+    int tilesX, tilesY;
+    float clipLimit;
+public:
+    ClaheFilter(int tx = 8, int ty = 8, float clip = 2.0f) : tilesX(tx), tilesY(ty), clipLimit(clip) {}
+
+    bool porBandas() const { return false; }   // los bloques abarcan toda la imagen
+
+    using Filter::aplicar;
+    void aplicar(ConstImageView input, ImageView output) {
+        int w = input.width;
+        int h = input.height;
+        int channels = input.channels;
+        int bins = input.maxColor + 1;
+        int tx = max(1, min(tilesX, w));
+        int ty = max(1, min(tilesY, h));
+        vector<int> luts((size_t)tx * ty * channels * bins);
+        // Cada hilo tiene a lo sumo un histograma de bloque vivo a la vez
+        int hilos = 1;
+#ifdef _OPENMP
+        hilos = omp_get_max_threads();
+#endif
+        registrarScratch(vectorBytes(luts) + (long long)hilos * bins * sizeof(int));
+
+        // Un mapeo por bloque y canal; los bloques son independientes entre sí
+        #pragma omp parallel for collapse(2) schedule(dynamic)
+        for (int by = 0; by < ty; by++) {
+            for (int bx = 0; bx < tx; bx++) {
+                TraceScope traza("clahe_tile", "tile", by * tx + bx);
+                int x0 = bx * w / tx, x1 = (bx + 1) * w / tx;
+                int y0 = by * h / ty, y1 = (by + 1) * h / ty;
+                int area = (x1 - x0) * (y1 - y0);
+                vector<int> hist(bins);
+
+                for (int c = 0; c < channels; c++) {
+                    fill(hist.begin(), hist.end(), 0);
+                    for (int y = y0; y < y1; y++) {
+                        for (int x = x0; x < x1; x++) {
+                            hist[clampValue(input.row(y)[x * channels + c], 0, input.maxColor)]++;
+                        }
+                    }
+
+                    // Recortar y repartir el exceso de forma uniforme entre todas las cubetas
+                    int limit = max(1, (int)(clipLimit * area / bins));
+                    long long excess = 0;
+                    for (int v = 0; v < bins; v++) {
+                        if (hist[v] > limit) {
+                            excess += hist[v] - limit;
+                            hist[v] = limit;
+                        }
+                    }
+                    int share = (int)(excess / bins);
+                    int rest = (int)(excess % bins);
+                    for (int v = 0; v < bins; v++) hist[v] += share;
+                    if (rest > 0) {
+                        int step = max(1, bins / rest);
+                        for (int v = 0; v < bins && rest > 0; v += step, rest--) hist[v]++;
+                    }
+
+                    int* lut = &luts[(((size_t)by * tx + bx) * channels + c) * bins];
+                    long long cdf = 0;
+                    for (int v = 0; v < bins; v++) {
+                        cdf += hist[v];
+                        lut[v] = (int)((cdf * input.maxColor + area / 2) / area);
+                    }
+                }
+            }
+        }
+
+        float tileW = (float)w / tx;
+        float tileH = (float)h / ty;
+
+        // Interpolación bilineal entre los centros de los bloques, por bandas de filas
+        #pragma omp parallel for schedule(static)
+        for (int y = 0; y < h; y++) {
+            float fy = (y + 0.5f) / tileH - 0.5f;
+            int iy0 = (int)floor(fy);
+            float wy = fy - iy0;
+            int iy1 = iy0 + 1;
+            if (iy0 < 0) { iy0 = 0; wy = 0.0f; }
+            if (iy1 > ty - 1) { iy1 = ty - 1; }
+            if (iy0 > ty - 1) { iy0 = ty - 1; }
+
+            for (int x = 0; x < w; x++) {
+                float fx = (x + 0.5f) / tileW - 0.5f;
+                int ix0 = (int)floor(fx);
+                float wx = fx - ix0;
+                int ix1 = ix0 + 1;
+                if (ix0 < 0) { ix0 = 0; wx = 0.0f; }
+                if (ix1 > tx - 1) { ix1 = tx - 1; }
+                if (ix0 > tx - 1) { ix0 = tx - 1; }
+
+                for (int c = 0; c < channels; c++) {
+                    int v = clampValue(input.row(y)[x * channels + c], 0, input.maxColor);
+                    float a = luts[(((size_t)iy0 * tx + ix0) * channels + c) * bins + v];
+                    float b = luts[(((size_t)iy0 * tx + ix1) * channels + c) * bins + v];
+                    float d = luts[(((size_t)iy1 * tx + ix0) * channels + c) * bins + v];
+                    float e = luts[(((size_t)iy1 * tx + ix1) * channels + c) * bins + v];
+                    float top = a + (b - a) * wx;
+                    float bottom = d + (e - d) * wx;
+                    output.row(y)[x * channels + c] = clampValue((int)(top + (bottom - top) * wy + 0.5f), 0, input.maxColor);
+                }
+            }
+        }
+    }
+};
+
+// crearConvolucion: devuelve el filtro de convolución con ese nombre, o NULL si no existe
+ConvolutionFilter* crearConvolucion(const string& nombre) {
+    if (nombre == "blur") return new BlurFilter();
+    if (nombre == "laplace") return new LaplaceFilter();
+    if (nombre == "sharpen") return new SharpenFilter();
+    return NULL;
+}
+
+// crearFiltro: interpreta el argumento de filtro.
+// Acepta blur, laplace, sharpen, equalize, clahe, gray (BT.601), gray709 y las
+// combinaciones fusionadas gray+<conv> o gray709+<conv>, por ejemplo gray+blur.
+// Después de una coma pueden ir operaciones puntuales (ver PointOps::parse): solas forman
+// un LutFilter, y tras una convolución se fusionan en su epílogo, por ejemplo
+// blur,gamma:2.2 o gray+sharpen,levels:16:235.
+Filter* crearFiltro(const string& filterArg) {
+    PointOps soloPuntuales;
+    if (soloPuntuales.parse(filterArg)) return new LutFilter(soloPuntuales);
+
+    string nombre = filterArg;
+    PointOps epilogo;
+    size_t coma = filterArg.find(',');
+    if (coma != string::npos) {
+        nombre = filterArg.substr(0, coma);
+        if (!epilogo.parse(filterArg.substr(coma + 1))) return NULL;
+    }
+
+    string primero = nombre;
+    string resto;
+    size_t mas = nombre.find('+');
+    if (mas != string::npos) {
+        primero = nombre.substr(0, mas);
+        resto = nombre.substr(mas + 1);
+    }
+
+    if (primero != "gray" && primero != "gray709") {
+        if (mas != string::npos) return NULL;
+        if (epilogo.empty()) {
+            if (nombre == "equalize") return new EqualizeFilter();
+            if (nombre == "clahe") return new ClaheFilter();
+        }
+        ConvolutionFilter* conv = crearConvolucion(nombre);
+        if (conv != NULL) conv->setEpilogo(epilogo);
+        return conv;
+    }
+
+    LumaStandard standard = (primero == "gray709") ? BT709 : BT601;
+    if (mas == string::npos) return epilogo.empty() ? new GrayscaleFilter(standard) : NULL;
+
+    ConvolutionFilter* conv = crearConvolucion(resto);
+    if (conv == NULL) return NULL;
+    conv->setEpilogo(epilogo);
+    return new GrayConvolutionFilter(standard, conv);
+}
+
+// nombreBase: la entrada sin carpeta ni extensión
+string nombreBase(const string& entrada) {
+    string base = entrada.substr(entrada.find_last_of('/') + 1);
+    size_t punto = base.find_last_of('.');
+    return punto == string::npos ? base : base.substr(0, punto);
+}
+
+// nombreSalida: dir/<nombre de la entrada sin extensión>.ppm o .pgm según los canales
+string nombreSalida(const string& dir, const string& entrada, const Image& result) {
+    return dir + "/" + nombreBase(entrada) + (result.channels() == 3 ? ".ppm" : ".pgm");
+}
+
+// modoBatch: filter --batch filtro dir_salida entrada1 [entrada2 ...]
+// Procesa muchos archivos en un solo proceso por lotes de FILTER_IO_BATCH archivos (8).
+// Mientras se filtra el lote k, bulkio.h ya está leyendo el lote k+1 y escribiendo el
+// k-1, así el disco no se queda sin pedidos. Fases: load es la espera de E/S (lecturas y
+// escrituras), parse y compute como siempre y save la codificación de las salidas.
+int modoBatch(int argc, char* argv[]) {
+    if (argc < 5) {
+        cerr << "Uso: " << argv[0] << " --batch filtro dir_salida entrada...\n";
+        return 1;
+    }
+    auto start = chrono::high_resolution_clock::now();
+    string filterArg = argv[2];
+    string dirSalida = argv[3];
+    PhaseTimer timer("serial");
+    timer.setFilter(filterArg);
+    Filter* filter = crearFiltro(filterArg);
+    if (filter == NULL) {
+        cerr << "Filtro no creado: " << filterArg << "\n";
+        return 1;
+    }
+
+    vector<string> entradas(argv + 4, argv + argc);
+    // Dos entradas con el mismo nombre base (a/x.ppm y b/x.ppm, o x.ppm y x.png) irían a la
+    // misma salida, y sus escrituras del mismo lote se mezclarían en el archivo
+    map<string, string> vistos;
+    for (const string& e : entradas) {
+        pair<map<string, string>::iterator, bool> r = vistos.insert(make_pair(nombreBase(e), e));
+        if (!r.second) {
+            cerr << "Entradas con la misma salida en " << dirSalida << ": " << r.first->second << " y " << e
+                 << "\n";
+            delete filter;
+            return 1;
+        }
+    }
+    const char* env = getenv("FILTER_IO_BATCH");
+    int porLote = (env && atoi(env) > 0) ? atoi(env) : 8;
+    int lotes = ((int)entradas.size() + porLote - 1) / porLote;
+
+    BulkIO io;
+    // Dos lotes de cada tipo alcanzan: el de lectura k+1 reusa el de k-1, ya procesado, y
+    // el de escritura k el de k-2, que terminó en el completar() de la vuelta anterior
+    vector<BulkIO::Archivo> lecturas[2], escrituras[2];
+    auto leerLote = [&](int k) {
+        vector<BulkIO::Archivo>& lote = lecturas[k % 2];
+        lote.clear();
+        for (int i = k * porLote; i < min((k + 1) * porLote, (int)entradas.size()); i++) {
+            BulkIO::Archivo a;
+            a.path = entradas[i];
+            lote.push_back(a);
+        }
+        io.leer(lote);
+    };
+
+    int fallos = 0;
+    leerLote(0);
+    {
+        PhaseTimer::Scope scope(&timer, PHASE_LOAD);
+        io.completar();
+    }
+    for (int k = 0; k < lotes; k++) {
+        if (k + 1 < lotes) leerLote(k + 1);
+        vector<BulkIO::Archivo>& salidas = escrituras[k % 2];
+        salidas.clear();
+        for (BulkIO::Archivo& a : lecturas[k % 2]) {
+            Image img, result;
+            if (!a.ok) {
+                cerr << "Error abriendo archivo: " << a.path << "\n";
+                fallos++;
+                continue;
+            }
+            bool ok = img.parse(a.datos, a.path, &timer, filter->borde());
+            string().swap(a.datos);
+            if (!ok) {
+                fallos++;
+                continue;
+            }
+            {
+                PhaseTimer::Scope scope(&timer, PHASE_COMPUTE);
+                filter->aplicar(img, result);
+            }
+            MemoryStats::instance().add(MEM_OUTPUT, vectorBytes(result.pixels));
+            BulkIO::Archivo salida;
+            salida.path = nombreSalida(dirSalida, a.path, result);
+            {
+                PhaseTimer::Scope scope(&timer, PHASE_SAVE);
+                result.encode(salida.datos);
+            }
+            salidas.push_back(std::move(salida));
+            io.bombear();
+        }
+        {
+            PhaseTimer::Scope scope(&timer, PHASE_LOAD);
+            io.completar();
+        }
+        // Las escrituras de k-1 terminaron en ese completar()
+        if (k > 0) {
+            for (BulkIO::Archivo& s : escrituras[(k - 1) % 2]) {
+                if (!s.ok) {
+                    cerr << "Error guardando archivo: " << s.path << "\n";
+                    fallos++;
+                }
+            }
+        }
+        io.escribir(salidas);
+    }
+    {
+        PhaseTimer::Scope scope(&timer, PHASE_LOAD);
+        io.completar();
+    }
+    if (lotes > 0) {
+        for (BulkIO::Archivo& s : escrituras[(lotes - 1) % 2]) {
+            if (!s.ok) {
+                cerr << "Error guardando archivo: " << s.path << "\n";
+                fallos++;
+            }
+        }
+    }
+
+    chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+    cout << "Procesados " << entradas.size() - fallos << " de " << entradas.size() << " archivos con "
+         << io.modo() << " en " << elapsed.count() << " segundos" << endl;
+    timer.addExtra("files", vector<long long>(1, (long long)entradas.size()));
+    timer.report();
+    Tracer::instance().dump();
+    delete filter;
+    return fallos == 0 ? 0 : 1;
+}
+
+// leerCabeceraPNM: tipo, ancho, alto y maxColor, como los lee Image::parse (sin
+// comentarios), más el separador único que precede a las muestras
+bool leerCabeceraPNM(LectorSecuencial& lector, string& magic, int& w, int& h, int& maxC) {
+    string campos[4];
+    for (int i = 0; i < 4; i++) {
+        char c;
+        do {
+            if (!lector.leer(&c, 1)) return false;
+        } while (isspace((unsigned char)c));
+        while (!isspace((unsigned char)c)) {
+            campos[i] += c;
+            if (!lector.leer(&c, 1)) return false;
+        }
+    }
+    magic = campos[0];
+    w = atoi(campos[1].c_str());
+    h = atoi(campos[2].c_str());
+    maxC = atoi(campos[3].c_str());
+    return w > 0 && h > 0 && maxC > 0 && maxC <= 65535;
+}
+
+// modoStream: filter --stream entrada salida filtro
+// Recorre un PNM binario (P5/P6) por bandas de FILTER_STREAM_ROWS filas (64) sin cargarlo
+// entero: la ventana guarda la banda más borde() filas de cada lado, que se corren hacia
+// arriba al pasar a la banda siguiente, y la salida se escribe banda por banda. La E/S
+// va por streamio.h (FILTER_STREAM_IO=buffered|mmap|direct). Sirve para los filtros cuyo
+// resultado depende sólo de vecinos cercanos (porBandas); equalize y clahe no.
+int modoStream(int argc, char* argv[]) {
+    if (argc < 5) {
+        cerr << "Uso: " << argv[0] << " --stream input.ppm output.ppm filtro\n";
+        return 1;
+    }
+    auto start = chrono::high_resolution_clock::now();
+    string filterArg = argv[4];
+    PhaseTimer timer("serial");
+    timer.setFilter(filterArg);
+    Filter* filter = crearFiltro(filterArg);
+    if (filter == NULL || !filter->porBandas()) {
+        cerr << "Filtro no disponible en modo stream: " << filterArg << "\n";
+        delete filter;
+        return 1;
+    }
+    StreamMode modo;
+    if (!streamModeFromEnv(modo)) {
+        cerr << "FILTER_STREAM_IO desconocido\n";
+        return 1;
+    }
+    const char* env = getenv("FILTER_STREAM_ROWS");
+    int filas = (env && atoi(env) > 0) ? atoi(env) : 64;
+
+    LectorSecuencial lector;
+    string magic;
+    int w, h, maxC;
+    {
+        PhaseTimer::Scope scope(&timer, PHASE_LOAD);
+        if (!lector.abrir(argv[2], modo)) {
+            cerr << "Error abriendo archivo: " << argv[2] << "\n";
+            return 1;
+        }
+        if (!leerCabeceraPNM(lector, magic, w, h, maxC)) {
+            cerr << "Cabecera inválida: " << argv[2] << "\n";
+            return 1;
+        }
+    }
+    if (magic != "P5" && magic != "P6") {
+        cerr << "El modo stream necesita un PNM binario (P5/P6): " << argv[2] << "\n";
+        return 1;
+    }
+
+    // ventana: filas [-g, filas + g) de la banda actual; las columnas de guarda quedan en
+    // cero y las filas fuera de la imagen se ponen en cero
+    int g = filter->borde();
+    filas = min(filas, h);
+    Image ventana, salida;
+    if (!ventana.allocate(magic, w, filas, maxC, g)) {
+        cerr << "Dimensiones no soportadas: " << argv[2] << " (" << w << "x" << h << ")\n";
+        return 1;
+    }
+    filter->preparar(ventana, salida);
+    MemoryStats::instance().add(MEM_INPUT, vectorBytes(ventana.pixels));
+    MemoryStats::instance().add(MEM_OUTPUT, vectorBytes(salida.pixels));
+
+    int chIn = ventana.channels(), chOut = salida.channels();
+    size_t bpsIn = maxC < 256 ? 1 : 2, bpsOut = salida.maxColor < 256 ? 1 : 2;
+    size_t filaIn = (size_t)w * chIn * bpsIn, filaOut = (size_t)w * chOut * bpsOut;
+    vector<unsigned char> crudo(filaIn * (filas + 2 * g)), codificado(filaOut * filas);
+    MemoryStats::instance().add(MEM_FILE, vectorBytes(crudo) + vectorBytes(codificado));
+
+    ostringstream cabecera;
+    cabecera << salida.magic << "\n" << w << " " << h << "\n" << salida.maxColor << "\n";
+    string cab = cabecera.str();
+    EscritorSecuencial escritor;
+    if (!escritor.abrir(argv[3], modo, cab.size() + filaOut * h) || !escritor.escribir(cab.data(), cab.size())) {
+        cerr << "Error guardando archivo: " << argv[3] << "\n";
+        return 1;
+    }
+
+    // cargar: lee n filas del archivo a la ventana desde la fila r (relativa a la banda)
+    auto cargar = [&](int r, int n) -> bool {
+        if (n <= 0) return true;
+        {
+            PhaseTimer::Scope scope(&timer, PHASE_LOAD);
+            if (!lector.leer(crudo.data(), filaIn * n)) return false;
+        }
+        PhaseTimer::Scope scope(&timer, PHASE_PARSE);
+        const unsigned char* raw = crudo.data();
+        int muestras = w * chIn;
+        for (int k = 0; k < n; k++, raw += filaIn) {
+            int* fila = ventana.row(r + k);
+            if (bpsIn == 1) {
+                for (int i = 0; i < muestras; i++) fila[i] = raw[i];
+            } else {
+                for (int i = 0; i < muestras; i++) fila[i] = (raw[2*i] << 8) | raw[2*i+1];
+            }
+        }
+        return true;
+    };
+    auto limpiar = [&](int r0, int r1) {
+        for (int r = r0; r < r1; r++) fill(ventana.row(r), ventana.row(r) + (size_t)w * chIn, 0);
+    };
+
+    bool ok = cargar(0, min(filas + g, h));
+    limpiar(min(filas + g, h), filas + g);
+    for (int y0 = 0; ok && y0 < h; y0 += filas) {
+        int n = min(filas, h - y0);
+        {
+            PhaseTimer::Scope scope(&timer, PHASE_COMPUTE);
+            const Image& v = ventana;
+            filter->aplicar(v.view().rows(0, n), salida.view().rows(0, n));
+        }
+        {
+            PhaseTimer::Scope scope(&timer, PHASE_SAVE);
+            unsigned char* dst = codificado.data();
+            int muestras = w * chOut;
+            for (int k = 0; k < n; k++) {
+                const int* fila = salida.row(k);
+                for (int i = 0; i < muestras; i++) {
+                    if (bpsOut == 1) {
+                        *dst++ = (unsigned char)fila[i];
+                    } else {
+                        *dst++ = (unsigned char)(fila[i] >> 8);
+                        *dst++ = (unsigned char)fila[i];
+                    }
+                }
+            }
+            ok = escritor.escribir(codificado.data(), filaOut * n);
+        }
+        if (!ok || y0 + filas >= h) break;
+        // Las 2g filas alrededor del borde inferior pasan a ser las de arriba de la banda
+        // siguiente; después se leen las filas que faltan
+        for (int r = -g; r < g; r++) {
+            copy(ventana.row(filas + r), ventana.row(filas + r) + (size_t)w * chIn, ventana.row(r));
+        }
+        int siguiente = y0 + filas;                  // fila de la imagen en la fila 0 de la ventana
+        int yaLeidas = min(siguiente + g, h);        // filas de la imagen leídas hasta ahora
+        int hasta = min(siguiente + filas + g, h);
+        ok = cargar(yaLeidas - siguiente, hasta - yaLeidas);
+        limpiar(hasta - siguiente, filas + g);
+    }
+    if (!ok) cerr << "Error procesando " << argv[2] << "\n";
+    {
+        PhaseTimer::Scope scope(&timer, PHASE_SAVE);
+        if (!escritor.cerrar()) {
+            cerr << "Error guardando archivo: " << argv[3] << "\n";
+            ok = false;
+        }
+    }
+    lector.cerrar();
+
+    chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+    cout << "Tiempo de ejecución: " << elapsed.count() << " segundos (E/S " << streamModeName(lector.modoReal())
+         << ")" << endl;
+    timer.report();
+    Tracer::instance().dump();
+    delete filter;
+    return ok ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--batch") return modoBatch(argc, argv);
+    if (argc > 1 && string(argv[1]) == "--stream") return modoStream(argc, argv);
     auto start = chrono::high_resolution_clock::now(); // Inicia el cronómetro
+    if (argc < 4) {
+        cerr << "Uso: " << argv[0] << " input.ppm output.ppm filtro\n";
+        cerr << "     " << argv[0] << " --batch filtro dir_salida entrada...\n";
+        cerr << "     " << argv[0] << " --stream input.ppm output.ppm filtro\n";
+        return 1;
+    }
+    PhaseTimer timer("serial");
     Image img, result;
-    if (!img.load(argv[1])) return 1;
-
     string filterArg = argv[3];
-    Filter* filter = NULL;
+    timer.setFilter(filterArg);
 
-    // Seleccionar filtro según el argumento
-    if (filterArg == "blur") filter = new BlurFilter();
-    else if (filterArg == "laplace") filter = new LaplaceFilter();
-    else if (filterArg == "sharpen") filter = new SharpenFilter();
-    else {
+    // Seleccionar filtro según el argumento; se crea antes de cargar la imagen para
+    // reservarle el borde de guarda que necesita
+    Filter* filter = crearFiltro(filterArg);
+    if (filter == NULL) {
         cerr << "Filtro no creado: " << filterArg << "\n";
         return 1;
     }
+    if (!img.load(argv[1], &timer, filter->borde())) return 1;
 
-    filter->aplicar(img, result);
+    // Los contadores heredan a los hilos que OpenMP cree dentro del filtro
+    PerfSample muestra;
+    {
+        PhaseTimer::Scope scope(&timer, PHASE_COMPUTE);
+        PerfCounters perf;
+        perf.start(true);
+        filter->aplicar(img, result);
+        muestra = perf.stop();
+    }
+    MemoryStats::instance().add(MEM_OUTPUT, vectorBytes(result.pixels));
+    reportCounters(timer, filterArg, muestra, (long long)(img.pixels.size() + result.pixels.size()) * sizeof(int));
 
-    result.save(argv[2]);
+    // La salida se escribe en el hilo de E/S mientras se libera la entrada y el filtro
+    future<bool> guardado = AsyncWriter::instance().guardar(std::move(result), argv[2], &timer);
+    img.pixels = PixelBuffer();
+    delete filter;
+    if (!guardado.get()) {
+        cerr << "No se pudo escribir la salida: " << argv[2] << "\n";
+        return 1;
+    }
     auto end = chrono::high_resolution_clock::now(); // Detiene el cronómetro
     chrono::duration<double> elapsed = end - start;
     cout << "Tiempo de ejecución: " << elapsed.count() << " segundos" << endl;
-    delete filter;
+    timer.report();
+    Tracer::instance().dump();
     return 0;
 }
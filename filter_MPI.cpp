@@ -4,63 +4,38 @@
 #include <vector>
 #include <string>
 #include <chrono>
+#include <sstream>
+#include "image.h"
+#include "perfcounters.h"
 
 using namespace std;
 using namespace std::chrono;
 
-inline int clampValue(int val, int minVal, int maxVal) {
-    return max(minVal, min(val, maxVal));
-}
-
-class Image {
-public:
-    string magic;
-    int width, height, maxColor;
-    vector<int> pixels;
-
-    bool load(const string& filename) {
-        ifstream in(filename);
-        if (!in.is_open()) return false;
-        in >> magic >> width >> height >> maxColor;
-        int channels = (magic == "P3") ? 3 : 1;
-        pixels.resize(width * height * channels);
-        for (int &p : pixels) in >> p;
-        return true;
-    }
-
-    bool save(const string& filename) {
-        ofstream out(filename);
-        if (!out.is_open()) return false;
-        out << magic << "\n" << width << " " << height << "\n" << maxColor << "\n";
-        for (int p : pixels) out << p << "\n";
-        return true;
-    }
-};
-
-// Aplica un kernel en un rango de filas
-void applyKernel(const Image& input, vector<int>& output,
-                 int startRow, int endRow, int channels,
+// Aplica un kernel sobre una banda de filas. in es una vista de la imagen completa
+// (Image::view().rows), así los vecinos de arriba y abajo de la banda se leen de las filas
+// vecinas sin copiarlas; out es la banda de salida, del mismo tamaño
+void applyKernel(ConstImageView in, ImageView out,
                  const vector<vector<float>>& kernel) {
-    int w = input.width, h = input.height;
+    int w = in.width, h = in.height, channels = in.channels;
     int half = kernel.size() / 2;
-    output.resize((endRow - startRow) * w * channels);
+    // Con guarda (filas vecinas o el borde en cero de Image) se lee sin comprobar límites
+    bool guarda = in.guard >= half;
 
-    for (int y = startRow; y < endRow; y++) {
+    for (int y = 0; y < h; y++) {
         for (int x = 0; x < w; x++) {
             for (int c = 0; c < channels; c++) {
                 float sum = 0;
                 for (int ky = -half; ky <= half; ky++) {
                     for (int kx = -half; kx <= half; kx++) {
                         int nx = x + kx, ny = y + ky;
-                        if (nx >= 0 && nx < w && ny >= 0 && ny < h) {
-                            int idx = (ny * w + nx) * channels + c;
-                            sum += input.pixels[idx] * kernel[ky + half][kx + half];
+                        if (guarda || (nx >= 0 && nx < w && ny >= 0 && ny < h)) {
+                            int idx = ny * in.stride + nx * channels + c;
+                            sum += in.data[idx] * kernel[ky + half][kx + half];
                         }
                     }
                 }
-                int localY = y - startRow;
-                int idxOut = (localY * w + x) * channels + c;
-                output[idxOut] = clampValue((int)sum, 0, input.maxColor);
+                int idxOut = y * out.stride + x * channels + c;
+                out.data[idxOut] = clampValue((int)sum, 0, in.maxColor);
             }
         }
     }
@@ -88,39 +63,51 @@ int main(int argc, char* argv[]) {
     } else if (filter == "sharpen") {
         kernel = {{0,-1,0},{-1,5,-1},{0,-1,0}};
     } else {
-        if (rank == 0) cerr << "Filtro no reconocido\n";
+        if (rank == 0 && filter.find_first_of(",+") != string::npos) {
+            cerr << "Filtro no soportado en MPI: " << filter << " (las etapas fusionadas con"
+                 << " \",\" o \"+\" sólo existen en filter)\n";
+        } else if (rank == 0) {
+            cerr << "Filtro no reconocido\n";
+        }
         MPI_Finalize();
         return 1;
     }
 
+    PhaseTimer timer("mpi", size);
+    timer.setFilter(filter);
+    Tracer& tracer = Tracer::instance();
+    tracer.setPid(rank);
+
     Image img;
     int w,h,maxColor,channels;
-    string magic;
 
     if (rank == 0) {
-        if (!img.load(argv[1])) {
+        if (!img.load(argv[1], &timer, kernel.size() / 2)) {
             cerr << "Error cargando imagen\n";
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
         w = img.width; h = img.height; maxColor = img.maxColor;
-        channels = (img.magic == "P3") ? 3 : 1;
-        magic = img.magic;
+        channels = img.channels();
     }
 
     // Compartir metadatos
+    long long commStart = nowNs();
     MPI_Bcast(&w,1,MPI_INT,0,MPI_COMM_WORLD);
     MPI_Bcast(&h,1,MPI_INT,0,MPI_COMM_WORLD);
     MPI_Bcast(&maxColor,1,MPI_INT,0,MPI_COMM_WORLD);
     MPI_Bcast(&channels,1,MPI_INT,0,MPI_COMM_WORLD);
 
     if (rank != 0) {
-        img.width=w; img.height=h; img.maxColor=maxColor;
-        img.magic=(channels==3)?"P3":"P2";
-        img.pixels.resize(w*h*channels);
+        img.allocate((channels==3)?"P3":"P2", w, h, maxColor, kernel.size() / 2);
+        // Cada rank guarda una copia completa de la entrada
+        MemoryStats::instance().add(MEM_INPUT, vectorBytes(img.pixels));
     }
 
     // Compartir imagen completa
-    MPI_Bcast(img.pixels.data(), w*h*channels, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(img.pixels.data(), img.pixels.size(), MPI_INT, 0, MPI_COMM_WORLD);
+    long long commEnd = nowNs();
+    timer.add(PHASE_COMM, commEnd - commStart);
+    tracer.record(phaseName(PHASE_COMM), "phase", commStart, commEnd);
 
     // División de trabajo
     int rowsPerProc = h / size;
@@ -128,39 +115,131 @@ int main(int argc, char* argv[]) {
     int endRow = (rank == size-1) ? h : startRow + rowsPerProc;
 
     // Cronómetro
+    long long computeStart = nowNs();
     auto start = high_resolution_clock::now();
 
-    vector<int> localBlock;
-    applyKernel(img, localBlock, startRow, endRow, channels, kernel);
+    // Rank 0 calcula directo sobre su banda de la imagen de salida y la recolección
+    // escribe las demás bandas en su lugar; los otros ranks sólo reservan su banda, con el
+    // mismo stride para que las filas recibidas queden alineadas
+    Image result;
+    ImageView localOut;
+    if (rank == 0) {
+        result.allocate(img.magic, w, h, maxColor);
+        localOut = result.view().rows(startRow, endRow);
+    } else {
+        result.allocate(img.magic, w, endRow - startRow, maxColor);
+        localOut = result.view();
+    }
+    MemoryStats::instance().add(MEM_OUTPUT, vectorBytes(result.pixels));
+
+    PerfCounters perf;
+    perf.start();
+    const Image& entrada = img;
+    applyKernel(entrada.view().rows(startRow, endRow), localOut, kernel);
+    PerfSample localPerf = perf.stop();
 
     auto end = high_resolution_clock::now();
     double elapsed = duration<double>(end - start).count();
+    timer.add(PHASE_COMPUTE, duration_cast<nanoseconds>(end - start).count());
+    tracer.record(phaseName(PHASE_COMPUTE), "phase", computeStart, nowNs(), rank);
 
-    // Recolectar resultados
+    // Recolectar resultados, en muestras desde la fila 0 de la salida
     vector<int> recvCounts(size), displs(size);
     for (int i=0; i<size; i++) {
         int s=i*rowsPerProc, e=(i==size-1)?h:s+rowsPerProc;
-        recvCounts[i]=(e-s)*w*channels;
+        recvCounts[i]=(e-s)*result.stride;
+        displs[i]=s*result.stride;
     }
-    displs[0]=0;
-    for (int i=1; i<size; i++) displs[i]=displs[i-1]+recvCounts[i-1];
-
-    vector<int> finalPixels;
-    if (rank==0) finalPixels.resize(w*h*channels);
 
-    MPI_Gatherv(localBlock.data(), localBlock.size(), MPI_INT,
-                rank==0?finalPixels.data():nullptr, recvCounts.data(), displs.data(),
-                MPI_INT,0,MPI_COMM_WORLD);
+    long long gatherStart = nowNs();
+    if (rank==0) {
+        MPI_Gatherv(MPI_IN_PLACE, 0, MPI_INT, result.row(0), recvCounts.data(), displs.data(),
+                    MPI_INT, 0, MPI_COMM_WORLD);
+    } else {
+        MPI_Gatherv(result.row(0), recvCounts[rank], MPI_INT, nullptr, recvCounts.data(),
+                    displs.data(), MPI_INT, 0, MPI_COMM_WORLD);
+    }
+    long long gatherEnd = nowNs();
+    timer.add(PHASE_GATHER, gatherEnd - gatherStart);
+    tracer.record(phaseName(PHASE_GATHER), "phase", gatherStart, gatherEnd);
 
     // Mostrar tiempo total y guardar resultado
     if (rank==0) {
-        Image result{magic,w,h,maxColor,finalPixels};
+        PhaseTimer::Scope scope(&timer, PHASE_SAVE);
         result.save(argv[2]);
         cout << "Filtro aplicado: " << filter << "\n";
         cout << "Imagen guardada en " << argv[2] << "\n";
         cout << "Tiempo total: " << elapsed << " s\n";
     }
 
+    // Cada fase se reporta como el máximo entre ranks (el camino crítico) y además
+    // se incluye el cómputo de cada rank para ver el desbalance
+    long long localNs[NUM_PHASES], maxNs[NUM_PHASES];
+    for (int p = 0; p < NUM_PHASES; p++) localNs[p] = timer.get((Phase)p);
+    MPI_Reduce(localNs, maxNs, NUM_PHASES, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    long long computeNs = timer.get(PHASE_COMPUTE);
+    vector<long long> computePerRank(size);
+    MPI_Gather(&computeNs, 1, MPI_LONG_LONG, computePerRank.data(), 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    // Contadores: suma de todos los ranks; si algún rank no pudo leerlos quedan inválidos
+    long long localCnt[NUM_COUNTERS], sumCnt[NUM_COUNTERS], minCnt[NUM_COUNTERS];
+    for (int c = 0; c < NUM_COUNTERS; c++) localCnt[c] = localPerf.values[c];
+    MPI_Reduce(localCnt, sumCnt, NUM_COUNTERS, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(localCnt, minCnt, NUM_COUNTERS, MPI_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+    // Memoria: cada categoría sumada sobre todos los ranks, más el total contabilizado y el
+    // pico de RSS de cada rank para dimensionar los slots del trabajo
+    MemoryStats& mem = MemoryStats::instance();
+    long long localMem[NUM_MEM_CATEGORIES], sumMem[NUM_MEM_CATEGORIES];
+    for (int c = 0; c < NUM_MEM_CATEGORIES; c++) localMem[c] = mem.get((MemCategory)c);
+    MPI_Reduce(localMem, sumMem, NUM_MEM_CATEGORIES, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    long long rankMem[2] = {mem.total(), peakRssBytes()};
+    vector<long long> memPerRank(2 * size);
+    MPI_Gather(rankMem, 2, MPI_LONG_LONG, memPerRank.data(), 2, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    if (rank==0) {
+        vector<long long> memoryBytes(size), peakRss(size);
+        for (int i = 0; i < size; i++) {
+            memoryBytes[i] = memPerRank[2 * i];
+            peakRss[i] = memPerRank[2 * i + 1];
+        }
+        for (int c = 0; c < NUM_MEM_CATEGORIES; c++) mem.set((MemCategory)c, sumMem[c]);
+        timer.addExtra("rank_memory_bytes", memoryBytes);
+        timer.addExtra("rank_peak_rss_bytes", peakRss);
+
+        PerfSample totalPerf;
+        for (int c = 0; c < NUM_COUNTERS; c++) totalPerf.values[c] = (minCnt[c] < 0) ? -1 : sumCnt[c];
+        reportCounters(timer, filter, totalPerf, (long long)w * h * channels * 2 * sizeof(int));
+        for (int p = 0; p < NUM_PHASES; p++) timer.set((Phase)p, maxNs[p]);
+        timer.addExtra("rank_compute_ns", computePerRank);
+        timer.report();
+    }
+
+    // Traza: rank 0 junta los eventos de todos los ranks en un solo archivo
+    if (tracer.enabled()) {
+        string local = tracer.eventsJson();
+        int len = local.size();
+        vector<int> lens(size), offsets(size);
+        MPI_Gather(&len, 1, MPI_INT, lens.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+        string all;
+        if (rank == 0) {
+            int total = 0;
+            for (int i = 0; i < size; i++) {
+                offsets[i] = total;
+                total += lens[i];
+            }
+            all.resize(total);
+        }
+        MPI_Gatherv(local.data(), len, MPI_CHAR, rank == 0 ? &all[0] : nullptr,
+                    lens.data(), offsets.data(), MPI_CHAR, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            string body;
+            for (int i = 0; i < size; i++) {
+                if (lens[i] == 0) continue;
+                if (!body.empty()) body += ",\n";
+                body += all.substr(offsets[i], lens[i]);
+            }
+            Tracer::writeFile(tracer.outputPath(), body);
+        }
+    }
+
     MPI_Finalize();
     return 0;
 }
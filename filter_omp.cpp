@@ -3,53 +3,27 @@
 #include <vector>
 #include <string>
 #include <omp.h>
+#include <algorithm>
 #include <chrono>
+#include <sstream>
+#include "image.h"
+#include "perfcounters.h"
+#include "writer.h"
 
 using namespace std;
 
-inline int clampValue(int val, int minVal, int maxVal) {
-    if (val < minVal) return minVal;
-    if (val > maxVal) return maxVal;
-    return val;
-}
-
-class Image {
-public:
-    string magic;
-    int width, height, maxColor;
-    vector<int> pixels;
-
-    bool load(const string& filename) {
-        ifstream in(filename.c_str());
-        if (!in.is_open()) {
-            cerr << "Error abriendo archivo: " << filename << "\n";
-            return false;
-        }
-        in >> magic >> width >> height >> maxColor;
-        int pixelCount = (magic == "P3") ? width * height * 3 : width * height;
-        pixels.resize(pixelCount);
-        for (int i = 0; i < pixelCount; i++) in >> pixels[i];
-        return true;
-    }
-
-    bool save(const string& filename) {
-        ofstream out(filename.c_str());
-        if (!out.is_open()) {
-            cerr << "Error guardando archivo: " << filename << "\n";
-            return false;
-        }
-        out << magic << "\n" << width << " " << height << "\n" << maxColor << "\n";
-        for (size_t i = 0; i < pixels.size(); i++) {
-            out << pixels[i] << "\n";
-        }
-        return true;
-    }
-};
-
 class Filter {
 public:
-    virtual void aplicar(const Image& input, Image& output) = 0;
+    // aplicar: out tiene las mismas dimensiones y canales que in; es secuencial, el
+    // paralelismo lo pone el reparto de bandas de main (Planificacion)
+    virtual void aplicar(ConstImageView in, ImageView out) = 0;
     virtual ~Filter() {}
+
+    // aplicar: reserva la salida del mismo tipo y tamaño y aplica sobre la imagen completa
+    void aplicar(const Image& input, Image& output) {
+        output.allocate(input.magic, input.width, input.height, input.maxColor);
+        aplicar(input.view(), output.view());
+    }
 };
 
 class ConvolutionFilter : public Filter {
@@ -57,29 +31,31 @@ protected:
     vector<vector<float>> kernel;
 public:
     ConvolutionFilter(const vector<vector<float>>& k) : kernel(k) {}
-    void aplicar(const Image& input, Image& output) {
-        output = input;
-        int channels = (input.magic == "P3") ? 3 : 1;
+    using Filter::aplicar;
+    void aplicar(ConstImageView in, ImageView out) {
+        int channels = in.channels;
         int kw = kernel[0].size();
         int half = kw / 2;
+        // Con guarda (vecinos reales o el borde en cero de Image) los vecinos de afuera se
+        // leen sin comprobar límites; si no, los bordes de la vista son los de la imagen
+        bool guarda = in.guard >= half;
 
-        #pragma omp parallel for collapse(2)
-        for (int y = 0; y < input.height; y++) {
-            for (int x = 0; x < input.width; x++) {
+        for (int y = 0; y < in.height; y++) {
+            for (int x = 0; x < in.width; x++) {
                 for (int c = 0; c < channels; c++) {
                     float sum = 0.0f;
                     for (int ky = -half; ky <= half; ky++) {
                         for (int kx = -half; kx <= half; kx++) {
                             int nx = x + kx;
                             int ny = y + ky;
-                            if (nx >= 0 && nx < input.width && ny >= 0 && ny < input.height) {
-                                int idx = (ny * input.width + nx) * channels + c;
-                                sum += input.pixels[idx] * kernel[ky+half][kx+half];
+                            if (guarda || (nx >= 0 && nx < in.width && ny >= 0 && ny < in.height)) {
+                                int idx = ny * in.stride + nx * channels + c;
+                                sum += in.data[idx] * kernel[ky+half][kx+half];
                             }
                         }
                     }
-                    int idx = (y * input.width + x) * channels + c;
-                    output.pixels[idx] = clampValue((int)sum, 0, input.maxColor);
+                    int idx = y * out.stride + x * channels + c;
+                    out.data[idx] = clampValue((int)sum, 0, in.maxColor);
                 }
             }
         }
@@ -113,57 +89,219 @@ public:
     }) {}
 };
 
+// Planificacion: cómo se reparten las bandas de filas de los tres filtros entre los hilos.
+// Se elige con variables de entorno (benchmark --omp-tune prueba las combinaciones):
+//   FILTER_OMP_SCHEDULE=tasks     una tarea por filtro que reparte sus bandas con taskloop
+//                                 (por defecto)
+//                      static     bloques contiguos de bandas por hilo (bandas de filas)
+//                      dynamic    cada hilo toma FILTER_OMP_CHUNK filas a la vez
+//                      guided     bloques que se achican hacia el final
+//   FILTER_OMP_CHUNK=N            filas por banda (32); una banda es la unidad de trabajo,
+//                                 así dos hilos nunca escriben en la misma fila de la salida
+//   FILTER_OMP_BIND=close|spread|master   proc_bind de la región paralela; sin definir,
+//                                 lo que digan OMP_PROC_BIND/OMP_PLACES
+struct Planificacion {
+    enum Tipo { TAREAS, STATIC, DYNAMIC, GUIDED };
+    enum Afinidad { BIND_DEFAULT, BIND_CLOSE, BIND_SPREAD, BIND_MASTER };
+    Tipo tipo = TAREAS;
+    int filas = 32;
+    Afinidad afinidad = BIND_DEFAULT;
+
+    // desdeEntorno: lee las variables; false si alguna tiene un valor desconocido
+    bool desdeEntorno() {
+        const char* env = getenv("FILTER_OMP_SCHEDULE");
+        string v = env ? env : "";
+        if (v == "static") tipo = STATIC;
+        else if (v == "dynamic") tipo = DYNAMIC;
+        else if (v == "guided") tipo = GUIDED;
+        else if (!v.empty() && v != "tasks") {
+            cerr << "FILTER_OMP_SCHEDULE desconocido: " << v << "\n";
+            return false;
+        }
+        env = getenv("FILTER_OMP_CHUNK");
+        if (env && atoi(env) > 0) filas = atoi(env);
+        env = getenv("FILTER_OMP_BIND");
+        v = env ? env : "";
+        if (v == "close") afinidad = BIND_CLOSE;
+        else if (v == "spread") afinidad = BIND_SPREAD;
+        else if (v == "master" || v == "primary") afinidad = BIND_MASTER;
+        else if (!v.empty() && v != "default") {
+            cerr << "FILTER_OMP_BIND desconocido: " << v << "\n";
+            return false;
+        }
+        return true;
+    }
+};
+
+// Trabajo: un filtro con su salida, su registro y el inicio/fin y los contadores de cada
+// banda; el cómputo del filtro va del comienzo de su primera banda al final de la última
+struct Trabajo {
+    const char* nombre;
+    const char* titulo;
+    Filter* filtro;
+    Image* salida;
+    PhaseTimer* timer;
+    PerfSample* perf;
+    vector<long long> inicio, fin;
+    vector<PerfSample> perfBandas;
+    future<bool> escritura;   // se cumple cuando el hilo de E/S escribió la salida
+
+    // Las bandas y la escritura se completan en main y en terminar
+    Trabajo(const char* n, const char* tit, Filter* f, Image* s, PhaseTimer* tm, PerfSample* p)
+        : nombre(n), titulo(tit), filtro(f), salida(s), timer(tm), perf(p) {}
+};
+
+// aplicarBanda: la banda b (de plan.filas filas) del trabajo t
+void aplicarBanda(ConstImageView in, Trabajo& t, int b, int filas) {
+    int y0 = b * filas;
+    int y1 = std::min(y0 + filas, in.height);
+    TraceScope traza("band", "tile", b);
+    // Contadores por banda: cada banda puede correr en cualquier hilo
+    PerfCounters perf;
+    perf.start();
+    t.inicio[b] = nowNs();
+    t.filtro->aplicar(in.rows(y0, y1), t.salida->view().rows(y0, y1));
+    t.fin[b] = nowNs();
+    t.perfBandas[b] = perf.stop();
+}
+
+// terminar: registra el cómputo y los contadores del trabajo y le pasa la salida al hilo de
+// E/S (writer.h); el hilo sigue con las bandas que queden sin esperar al disco
+void terminar(Trabajo& t) {
+    long long desde = *min_element(t.inicio.begin(), t.inicio.end());
+    long long hasta = *max_element(t.fin.begin(), t.fin.end());
+    t.timer->add(PHASE_COMPUTE, hasta - desde);
+    for (size_t b = 0; b < t.perfBandas.size(); b++) t.perf->add(t.perfBandas[b]);
+    #pragma omp critical
+    cout << "Tiempo " << t.titulo << ": " << (hasta - desde) / 1e9 << " s\n";
+    t.escritura = AsyncWriter::instance().guardar(std::move(*t.salida), string("out_") + t.nombre + ".ppm",
+                                                  t.timer);
+}
+
+// procesar: cuerpo de la región paralela, lo ejecutan todos los hilos. Antes eran tres
+// sections con un parallel for anidado, que sin paralelismo anidado corría en un hilo por
+// filtro (3 hilos en total) y con él creaba 3 x OMP_NUM_THREADS hilos; ahora las bandas
+// de los tres filtros se reparten juntas en una sola región. Las tareas reciben la vista
+// y no la imagen: una referencia en una tarea es firstprivate y copiaría la imagen entera
+void procesar(ConstImageView in, Trabajo* trabajos, int n, int filas, Planificacion::Tipo tipo) {
+    int bandas = (int)trabajos[0].inicio.size();
+    if (tipo == Planificacion::TAREAS) {
+        // Las bandas de los tres filtros comparten la cola de tareas y cada filtro se
+        // guarda apenas terminan las suyas
+        #pragma omp single
+        for (int i = 0; i < n; i++) {
+            #pragma omp task firstprivate(i)
+            {
+                TraceScope traza(trabajos[i].nombre, "filter");
+                #pragma omp taskloop grainsize(1)
+                for (int b = 0; b < bandas; b++) aplicarBanda(in, trabajos[i], b, filas);
+                terminar(trabajos[i]);
+            }
+        }
+        return;
+    }
+    // static/dynamic/guided: un solo ciclo sobre (filtro, banda) con schedule(runtime);
+    // main fija el tipo con omp_set_schedule
+    #pragma omp for schedule(runtime)
+    for (int k = 0; k < n * bandas; k++) aplicarBanda(in, trabajos[k / bandas], k % bandas, filas);
+    #pragma omp for schedule(dynamic)
+    for (int i = 0; i < n; i++) terminar(trabajos[i]);
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         cerr << "Uso: " << argv[0] << " input.ppm\n";
         return 1;
     }
 
+    PhaseTimer timer("omp", omp_get_max_threads());
     Image img;
-    if (!img.load(argv[1])) return 1;
+    // Borde de guarda de un píxel: los tres kernels son 3x3
+    if (!img.load(argv[1], &timer, 1)) return 1;
 
     Image resultBlur, resultLaplace, resultSharpen;
 
+    // Un registro por filtro; todos comparten las fases load y parse
+    PhaseTimer timerBlur = timer, timerLaplace = timer, timerSharpen = timer;
+    timerBlur.setFilter("blur");
+    timerLaplace.setFilter("laplace");
+    timerSharpen.setFilter("sharpen");
+    PerfSample perfBlur, perfLaplace, perfSharpen;
+
+    Planificacion plan;
+    if (!plan.desdeEntorno()) return 1;
+
+    BlurFilter blur;
+    LaplaceFilter laplace;
+    SharpenFilter sharp;
+    Trabajo trabajos[3] = {
+        {"blur", "Blur", &blur, &resultBlur, &timerBlur, &perfBlur},
+        {"laplace", "Laplace", &laplace, &resultLaplace, &timerLaplace, &perfLaplace},
+        {"sharpen", "Sharpen", &sharp, &resultSharpen, &timerSharpen, &perfSharpen}
+    };
+    int bandas = max(1, (img.height + plan.filas - 1) / plan.filas);
+    for (Trabajo& t : trabajos) {
+        t.salida->allocate(img.magic, img.width, img.height, img.maxColor);
+        MemoryStats::instance().add(MEM_OUTPUT, vectorBytes(t.salida->pixels));
+        t.inicio.assign(bandas, 0);
+        t.fin.assign(bandas, 0);
+        t.perfBandas.assign(bandas, PerfSample());
+    }
+    // Con static y chunk 0 cada hilo recibe un bloque contiguo de bandas
+    if (plan.tipo == Planificacion::STATIC) omp_set_schedule(omp_sched_static, 0);
+    else if (plan.tipo == Planificacion::DYNAMIC) omp_set_schedule(omp_sched_dynamic, 1);
+    else if (plan.tipo == Planificacion::GUIDED) omp_set_schedule(omp_sched_guided, 1);
+
     auto totalStart = chrono::high_resolution_clock::now();
 
-    // Se ejecutan los 3 filtros en paralelo con OpenMP sections
-    #pragma omp parallel sections
-    {
-        #pragma omp section
-        {
-            auto start = chrono::high_resolution_clock::now();
-            BlurFilter blur;
-            blur.aplicar(img, resultBlur);
-            auto end = chrono::high_resolution_clock::now();
-            chrono::duration<double> elapsed = end - start;
-            cout << "Tiempo Blur: " << elapsed.count() << " s\n";
-            resultBlur.save("out_blur.ppm");
-        }
-        #pragma omp section
-        {
-            auto start = chrono::high_resolution_clock::now();
-            LaplaceFilter laplace;
-            laplace.aplicar(img, resultLaplace);
-            auto end = chrono::high_resolution_clock::now();
-            chrono::duration<double> elapsed = end - start;
-            cout << "Tiempo Laplace: " << elapsed.count() << " s\n";
-            resultLaplace.save("out_laplace.ppm");
-        }
-        #pragma omp section
-        {
-            auto start = chrono::high_resolution_clock::now();
-            SharpenFilter sharp;
-            sharp.aplicar(img, resultSharpen);
-            auto end = chrono::high_resolution_clock::now();
-            chrono::duration<double> elapsed = end - start;
-            cout << "Tiempo Sharpen: " << elapsed.count() << " s\n";
-            resultSharpen.save("out_sharpen.ppm");
-        }
+    const Image& imagen = img;
+    ConstImageView entrada = imagen.view();
+    // proc_bind sólo se puede dar como cláusula, así que hay una región por política
+    switch (plan.afinidad) {
+    case Planificacion::BIND_CLOSE:
+        #pragma omp parallel proc_bind(close)
+        procesar(entrada, trabajos, 3, plan.filas, plan.tipo);
+        break;
+    case Planificacion::BIND_SPREAD:
+        #pragma omp parallel proc_bind(spread)
+        procesar(entrada, trabajos, 3, plan.filas, plan.tipo);
+        break;
+    case Planificacion::BIND_MASTER:
+        #pragma omp parallel proc_bind(master)
+        procesar(entrada, trabajos, 3, plan.filas, plan.tipo);
+        break;
+    default:
+        #pragma omp parallel
+        procesar(entrada, trabajos, 3, plan.filas, plan.tipo);
     }
 
+    bool guardados = true;
+    for (Trabajo& t : trabajos) {
+        if (!t.escritura.get()) {
+            cerr << "No se pudo escribir la salida: out_" << t.nombre << ".ppm\n";
+            guardados = false;
+        }
+    }
+    if (!guardados) return 1;
     auto totalEnd = chrono::high_resolution_clock::now();
+    // region_ns: de la primera banda a la última de los tres filtros; es lo que compara
+    // benchmark --omp-tune entre planificaciones
+    long long desde = trabajos[0].inicio[0], hasta = 0;
+    for (Trabajo& t : trabajos) {
+        desde = min(desde, *min_element(t.inicio.begin(), t.inicio.end()));
+        hasta = max(hasta, *max_element(t.fin.begin(), t.fin.end()));
+    }
+    for (Trabajo& t : trabajos) t.timer->addExtra("region_ns", vector<long long>(1, hasta - desde));
     chrono::duration<double> totalElapsed = totalEnd - totalStart;
     cout << "Tiempo total de ejecución: " << totalElapsed.count() << " s\n";
+    long long bytes = (long long)img.pixels.size() * 2 * sizeof(int);
+    reportCounters(timerBlur, "blur", perfBlur, bytes);
+    reportCounters(timerLaplace, "laplace", perfLaplace, bytes);
+    reportCounters(timerSharpen, "sharpen", perfSharpen, bytes);
+    timerBlur.report();
+    timerLaplace.report();
+    timerSharpen.report();
+    Tracer::instance().dump();
 
     return 0;
 }
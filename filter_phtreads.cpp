@@ -5,43 +5,19 @@
 #include <pthread.h>
 #include <algorithm>
 #include <chrono>
+#include <sstream>
+#include "image.h"
+#include "tiled.h"
+#include "perfcounters.h"
 
 
 using namespace std;
 
-inline int clampValue(int val, int minVal, int maxVal) {
-    if (val < minVal) return minVal;
-    if (val > maxVal) return maxVal;
-    return val;
-}
-
-class Image {
-public:
-    string magic;
-    int width, height, maxColor;
-    vector<int> pixels;
-    bool load(const string& filename) {
-        ifstream in(filename.c_str());
-        if (!in.is_open()) return false;
-        in >> magic >> width >> height >> maxColor;
-        int pixelCount = (magic == "P3") ? width * height * 3 : width * height;
-        pixels.resize(pixelCount);
-        for (int i = 0; i < pixelCount; i++) in >> pixels[i];
-        return true;
-    }
-    bool save(const string& filename) {
-        ofstream out(filename.c_str());
-        if (!out.is_open()) return false;
-        out << magic << "\n" << width << " " << height << "\n" << maxColor << "\n";
-        for (size_t i = 0; i < pixels.size(); i++) out << pixels[i] << "\n";
-        return true;
-    }
-};
-
 class Filter {
 public:
-    virtual void ApliRegion(const Image& input, Image& output,
-                            int startX, int startY, int endX, int endY) = 0;
+    // ApliRegion: aplica el filtro sobre una región; in y out son vistas del mismo tamaño
+    // (Image::view().sub), así cada hilo sólo ve su cuadrante
+    virtual void ApliRegion(ConstImageView in, ImageView out) = 0;
     virtual ~Filter() {}
 };
 
@@ -50,28 +26,30 @@ protected:
     vector<vector<float> > kernel;
 public:
     ConvolutionFilter(const vector<vector<float> >& k) : kernel(k) {}
-    void ApliRegion(const Image& input, Image& output,
-                    int startX, int startY, int endX, int endY) {
-        int channels = (input.magic == "P3") ? 3 : 1;
+    void ApliRegion(ConstImageView in, ImageView out) {
+        int channels = in.channels;
         int kw = kernel[0].size();
         int kh = kernel.size();
         int half = kw / 2;
-        for (int y = startY; y < endY; y++) {
-            for (int x = startX; x < endX; x++) {
+        // Con guarda los vecinos de afuera del cuadrante se leen de los cuadrantes vecinos
+        // o del borde en cero de Image, sin comprobar límites
+        bool guarda = in.guard >= half;
+        for (int y = 0; y < in.height; y++) {
+            for (int x = 0; x < in.width; x++) {
                 for (int c = 0; c < channels; c++) {
                     float sum = 0.0f;
                     for (int ky = -half; ky <= half; ky++) {
                         for (int kx = -half; kx <= half; kx++) {
                             int nx = x + kx;
                             int ny = y + ky;
-                            if (nx >= 0 && nx < input.width && ny >= 0 && ny < input.height) {
-                                int idx = (ny * input.width + nx) * channels + c;
-                                sum += input.pixels[idx] * kernel[ky+half][kx+half];
+                            if (guarda || (nx >= 0 && nx < in.width && ny >= 0 && ny < in.height)) {
+                                int idx = ny * in.stride + nx * channels + c;
+                                sum += in.data[idx] * kernel[ky+half][kx+half];
                             }
                         }
                     }
-                    int idx = (y * input.width + x) * channels + c;
-                    output.pixels[idx] = clampValue((int)sum, 0, input.maxColor);
+                    int idx = y * out.stride + x * channels + c;
+                    out.data[idx] = clampValue((int)sum, 0, in.maxColor);
                 }
             }
         }
@@ -106,48 +84,133 @@ public:
 };
 
 struct ThreadInfo {
-    const Image* input;
-    Image* output;
+    ConstImageView in;   // cuadrante de la entrada (con un .ptl, de su propia Image)
+    ImageView out;       // el mismo cuadrante de la salida
     Filter* filter;
-    int startX, startY, endX, endY;
+    PerfSample perf;  // contadores de hardware de este hilo
+    int id;           // número de cuadrante, para la traza
 };
 
 void* Func(void* arg) {
     ThreadInfo* data = (ThreadInfo*)arg;
-    data->filter->ApliRegion(*data->input, *data->output,
-                             data->startX, data->startY, data->endX, data->endY);
+    TraceScope traza("quadrant", "tile", data->id);
+    PerfCounters perf;
+    perf.start();
+    data->filter->ApliRegion(data->in, data->out);
+    data->perf = perf.stop();
+    return NULL;
+}
+
+// LecturaInfo: cuadrante que un hilo lee de un contenedor .ptl
+struct LecturaInfo {
+    TileContainer* tiles;
+    int x, y, w, h;
+    Image* destino;
+    bool ok;
+};
+
+void* LeerCuadrante(void* arg) {
+    LecturaInfo* data = (LecturaInfo*)arg;
+    TraceScope traza("read_quadrant", "tile");
+    data->ok = data->tiles->readRegion(data->x, data->y, data->w, data->h, 1, *data->destino);
     return NULL;
 }
 
 int main(int argc, char* argv[]) {
     auto start = chrono::high_resolution_clock::now(); // Inicia el cronómetro
+    PhaseTimer timer("pthreads", 4);
     Image img, result;
-    if (!img.load(argv[1])) return 1;
-    result = img;
+    // Con un contenedor por teselas (.ptl, tiled.h) no se carga la imagen entera: cada
+    // hilo lee en paralelo sólo las teselas de su cuadrante más un píxel de halo
+    TileContainer tiles;
+    bool porTeselas = tiles.open(argv[1]);
+    if (porTeselas) {
+        const TileContainer::Header& h = tiles.header();
+        img.magic = h.magic;
+        img.width = h.width;
+        img.height = h.height;
+        img.maxColor = h.maxColor;
+    } else if (!img.load(argv[1], &timer, 1)) {   // Borde de guarda de un píxel: los tres kernels son 3x3
+        return 1;
+    }
+    if (!result.allocate(img.magic, img.width, img.height, img.maxColor)) {
+        cerr << "Dimensiones no soportadas: " << argv[1] << " (" << img.width << "x" << img.height << ")\n";
+        return 1;
+    }
+    MemoryStats::instance().add(MEM_OUTPUT, vectorBytes(result.pixels));
     string filterArg = argv[3];
+    timer.setFilter(filterArg);
     Filter* filter = NULL;
     if (filterArg == "blur") filter = new BlurFilter();
     else if (filterArg == "laplace") filter = new LaplaceFilter();
     else if (filterArg == "sharpen") filter = new SharpenFilter();
     else {
-        cerr << "Filtro no creado: " << filterArg << "\n";
+        if (filterArg.find_first_of(",+") != string::npos) {
+            cerr << "Filtro no soportado en pthreads: " << filterArg << " (las etapas fusionadas con"
+                 << " \",\" o \"+\" sólo existen en filter)\n";
+        } else {
+            cerr << "Filtro no creado: " << filterArg << "\n";
+        }
         return 1;
     }
     int midX = img.width / 2;
     int midY = img.height / 2;
     pthread_t threads[4];
-    ThreadInfo data[4] = {
-        {&img, &result, filter, 0,    0,    midX, midY},
-        {&img, &result, filter, midX, 0,    img.width, midY},
-        {&img, &result, filter, 0,    midY, midX, img.height},
-        {&img, &result, filter, midX, midY, img.width, img.height}
-    };
-    for (int i = 0; i < 4; i++) pthread_create(&threads[i], NULL, Func, &data[i]);
-    for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
-    result.save(argv[2]);
+    const Image& entrada = img;
+    ConstImageView in = entrada.view();
+    ImageView out = result.view();
+    int x0[4] = {0, midX, 0, midX}, y0[4] = {0, 0, midY, midY};
+    int x1[4] = {midX, img.width, midX, img.width}, y1[4] = {midY, midY, img.height, img.height};
+    Image cuadrante[4];
+    if (porTeselas) {
+        PhaseTimer::Scope scope(&timer, PHASE_LOAD);
+        LecturaInfo lectura[4];
+        for (int i = 0; i < 4; i++) {
+            lectura[i] = {&tiles, x0[i], y0[i], x1[i] - x0[i], y1[i] - y0[i], &cuadrante[i], false};
+            pthread_create(&threads[i], NULL, LeerCuadrante, &lectura[i]);
+        }
+        bool ok = true;
+        for (int i = 0; i < 4; i++) {
+            pthread_join(threads[i], NULL);
+            ok = ok && lectura[i].ok;
+        }
+        if (!ok) return 1;
+        // Las teselas que cruzan el borde entre cuadrantes las leen los dos hilos
+        cout << "Lecturas de teselas: " << tiles.getTilesRead() << " (el archivo tiene " << tiles.header().tiles()
+             << ")\n";
+    }
+    ThreadInfo data[4];
+    for (int i = 0; i < 4; i++) {
+        const Image& propio = cuadrante[i];
+        data[i].in = porTeselas ? propio.view() : in.sub(x0[i], y0[i], x1[i] - x0[i], y1[i] - y0[i]);
+        data[i].out = out.sub(x0[i], y0[i], x1[i] - x0[i], y1[i] - y0[i]);
+        data[i].filter = filter;
+        data[i].id = i;
+    }
+    {
+        PhaseTimer::Scope scope(&timer, PHASE_COMPUTE);
+        for (int i = 0; i < 4; i++) pthread_create(&threads[i], NULL, Func, &data[i]);
+        for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+    }
+    PerfSample total;
+    vector<long long> threadCycles;
+    for (int i = 0; i < 4; i++) {
+        total.add(data[i].perf);
+        threadCycles.push_back(data[i].perf.values[CNT_CYCLES]);
+    }
+    if (total.valid()) timer.addExtra("thread_cycles", threadCycles);
+    size_t muestras = img.pixels.size();
+    for (int i = 0; i < 4; i++) muestras += cuadrante[i].pixels.size();
+    reportCounters(timer, filterArg, total, (long long)muestras * 2 * sizeof(int));
+    {
+        PhaseTimer::Scope scope(&timer, PHASE_SAVE);
+        result.save(argv[2]);
+    }
     auto end = chrono::high_resolution_clock::now(); // Detiene el cronómetro
     chrono::duration<double> elapsed = end - start;
     cout << "Tiempo de ejecución: " << elapsed.count() << " segundos" << endl;
+    timer.report();
+    Tracer::instance().dump();
     delete filter;
     return 0;
 }
@@ -0,0 +1,163 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include "image.h"
+#include "tiled.h"
+#include "codecs.h"
+
+using namespace std;
+
+bool Image::load(const string& filename, PhaseTimer* timer, int guard) {
+    string data;
+    if (!readFile(filename, data, timer)) {
+        cerr << "Error abriendo archivo: " << filename << "\n";
+        return false;
+    }
+    return parse(data, filename, timer, guard);
+}
+
+bool Image::parse(const string& data, const string& filename, PhaseTimer* timer, int guard) {
+    PhaseTimer::Scope scope(timer, PHASE_PARSE);
+    if (TileContainer::isTiled(data)) return TileContainer::decode(data, filename, *this, guard);
+    if (PngCodec::isPng(data)) return PngCodec::decode(data, filename, *this, guard);
+    if (QoiCodec::isQoi(data)) return QoiCodec::decode(data, filename, *this, guard);
+    istringstream in(data);
+    string m;
+    int w, h, maxC;
+    in >> m >> w >> h >> maxC;
+    bool tipo = m == "P2" || m == "P3" || m == "P5" || m == "P6";
+    if (!in || !tipo || w <= 0 || h <= 0 || maxC <= 0 || maxC > 65535) {
+        cerr << "Cabecera inválida: " << filename << "\n";
+        return false;
+    }
+    // Cada muestra ocupa al menos un byte del archivo, así una cabecera no puede pedir más
+    // memoria que la que justifican los datos
+    int canales = (m == "P3" || m == "P6") ? 3 : 1;
+    if ((unsigned long long)w * h * canales > data.size()) {
+        cerr << "Archivo incompleto: " << filename << "\n";
+        return false;
+    }
+    if (!allocate(m, w, h, maxC, guard)) {
+        cerr << "Dimensiones no soportadas: " << filename << " (" << w << "x" << h << ")\n";
+        return false;
+    }
+    MemoryStats::instance().add(MEM_INPUT, vectorBytes(pixels));
+    int rowSize = width * channels();
+
+    if (isBinary()) {
+        // Un único separador tras maxColor y luego las muestras (1 o 2 bytes big-endian)
+        in.get();
+        size_t offset = (size_t)in.tellg();
+        int bytesPerSample = (maxColor < 256) ? 1 : 2;
+        if (data.size() < offset + (size_t)rowSize * height * bytesPerSample) {
+            cerr << "Archivo incompleto: " << filename << "\n";
+            return false;
+        }
+        const unsigned char* raw = (const unsigned char*)data.data() + offset;
+        for (int y = 0; y < height; y++, raw += (size_t)rowSize * bytesPerSample) {
+            int* fila = row(y);
+            if (bytesPerSample == 1) {
+                for (int i = 0; i < rowSize; i++) fila[i] = raw[i];
+            } else {
+                for (int i = 0; i < rowSize; i++) fila[i] = (raw[2*i] << 8) | raw[2*i+1];
+            }
+        }
+        return true;
+    }
+
+    for (int y = 0; y < height; y++) {
+        int* fila = row(y);
+        for (int i = 0; i < rowSize; i++) in >> fila[i];
+    }
+    return true;
+}
+
+static bool terminaEn(const string& nombre, const char* ext) {
+    size_t n = strlen(ext);
+    return nombre.size() > n && nombre.compare(nombre.size() - n, n, ext) == 0;
+}
+
+bool Image::save(const string& filename) const {
+    string data;
+    if (terminaEn(filename, ".ptl")) {
+        TileContainer::encode(*this, data);
+    } else if (terminaEn(filename, ".png")) {
+        PngCodec::encode(*this, data);
+    } else if (terminaEn(filename, ".qoi")) {
+        if (!QoiCodec::encode(*this, data)) return false;
+    } else {
+        encode(data);
+    }
+    ofstream out(filename.c_str(), ios::binary);
+    if (!out.is_open()) {
+        cerr << "Error guardando archivo: " << filename << "\n";
+        return false;
+    }
+    out.write(data.data(), data.size());
+    // El close vacía el búfer: un disco lleno recién puede aparecer acá
+    out.close();
+    return !out.fail();
+}
+
+void Image::encode(string& data) const {
+    ostringstream cabecera;
+    cabecera << magic << "\n" << width << " " << height << "\n" << maxColor << "\n";
+    data = cabecera.str();
+    int rowSize = width * channels();
+    size_t inicio = data.size();
+    if (isBinary()) {
+        int bytesPerSample = (maxColor < 256) ? 1 : 2;
+        data.resize(inicio + (size_t)rowSize * height * bytesPerSample);
+        MemoryStats::instance().add(MEM_FILE, (long long)data.capacity());
+        unsigned char* dst = (unsigned char*)&data[inicio];
+        for (int y = 0; y < height; y++) {
+            const int* fila = row(y);
+            for (int i = 0; i < rowSize; i++) {
+                if (bytesPerSample == 1) {
+                    *dst++ = (unsigned char)fila[i];
+                } else {
+                    *dst++ = (unsigned char)(fila[i] >> 8);
+                    *dst++ = (unsigned char)fila[i];
+                }
+            }
+        }
+        return;
+    }
+    // ASCII: una muestra por línea. Una primera pasada cuenta los caracteres para reservar
+    // el tamaño exacto
+    size_t total = 0;
+    for (int y = 0; y < height; y++) {
+        const int* fila = row(y);
+        for (int i = 0; i < rowSize; i++) {
+            long long v = fila[i];
+            total += (v < 0) ? 3 : 2;   // signo, primer dígito y salto de línea
+            if (v < 0) v = -v;
+            while (v >= 10) {
+                total++;
+                v /= 10;
+            }
+        }
+    }
+    data.resize(inicio + total);
+    MemoryStats::instance().add(MEM_FILE, (long long)data.capacity());
+    char* dst = &data[inicio];
+    for (int y = 0; y < height; y++) {
+        const int* fila = row(y);
+        for (int i = 0; i < rowSize; i++) {
+            long long v = fila[i];
+            if (v < 0) {
+                *dst++ = '-';
+                v = -v;
+            }
+            char digitos[12];
+            int n = 0;
+            do {
+                digitos[n++] = (char)('0' + v % 10);
+                v /= 10;
+            } while (v > 0);
+            while (n > 0) *dst++ = digitos[--n];
+            *dst++ = '\n';
+        }
+    }
+}
@@ -0,0 +1,176 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+// image.h: imagen en memoria y lectura/escritura PNM, compartidas por los cuatro backends
+// (biblioteca filtercommon).
+
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <new>
+#include <vector>
+#include "pool.h"
+#include "timing.h"
+
+// clampValue: asegura que un valor entero se encuentre dentro de un rango [minVal, maxVal].
+// Esto se usa para evitar que los valores de los píxeles se salgan del rango válido.
+inline int clampValue(int val, int minVal, int maxVal) {
+    if (val < minVal) return minVal;
+    if (val > maxVal) return maxVal;
+    return val;
+}
+
+// BasicView: vista sin dueño sobre los píxeles de una imagen (puntero, dimensiones, stride,
+// canales). Sirve para pasarle a los filtros la imagen completa, una banda de filas, un
+// cuadrante o un bloque sin copiar nada. guard dice cuántos píxeles se pueden leer más
+// allá de cada borde de la vista con el valor que vería una convolución: vecinos reales
+// de la imagen de la que salió o el borde de guarda en cero de Image.
+template <class T>
+struct BasicView {
+    T* data;              // muestra (0, 0, 0) de la vista
+    int width, height;
+    int channels;
+    int stride;           // muestras entre filas
+    int maxColor;
+    int guard;
+
+    T* row(int y) const { return data + (ptrdiff_t)y * stride; }
+
+    // sub: rectángulo [x, x + w) x [y, y + h) de esta vista, sin copiar
+    BasicView sub(int x, int y, int w, int h) const {
+        int g = guard + x;
+        g = g < guard + y ? g : guard + y;
+        g = g < guard + (width - x - w) ? g : guard + (width - x - w);
+        g = g < guard + (height - y - h) ? g : guard + (height - y - h);
+        BasicView v = {row(y) + x * channels, w, h, channels, stride, maxColor, g};
+        return v;
+    }
+
+    // rows: banda de filas [y0, y1) con el ancho completo
+    BasicView rows(int y0, int y1) const { return sub(0, y0, width, y1 - y0); }
+
+    // Una vista de escritura también se puede leer
+    operator BasicView<const T>() const {
+        BasicView<const T> v = {data, width, height, channels, stride, maxColor, guard};
+        return v;
+    }
+};
+
+typedef BasicView<int> ImageView;
+typedef BasicView<const int> ConstImageView;
+
+// La clase Image representa una imagen en memoria.
+// Contiene sus metadatos (tipo P2/P3/P5/P6, ancho, alto, valor máximo de color) y los píxeles.
+//
+// Disposición en memoria: cada fila ocupa stride muestras (strideBytes() en bytes).
+// Alrededor de la imagen puede haber un borde de guarda de border píxeles en cada lado,
+// siempre en cero: un kernel de radio <= border lee fuera de la imagen sin comprobar
+// límites y obtiene lo mismo que si saltara esos vecinos. La fila se rellena hasta un
+// múltiplo de la línea de caché (FILTER_ROW_PAD=0 la deja compacta) y, si el stride en
+// bytes es múltiplo de 4 KB (anchos potencia de dos), se agrega una línea más para que
+// las filas vecinas no caigan en el mismo conjunto de la caché.
+// La muestra (x, y, c) está en row(y)[x * channels + c], con -border <= x, y.
+class Image {
+public:
+    std::string magic;
+    int width, height;
+    int maxColor;
+    PixelBuffer pixels;   // bloques del pool (pool.h), alineados a 64 bytes
+    int stride = 0;       // muestras entre el inicio de dos filas consecutivas
+    int border = 0;       // píxeles de guarda en cada lado
+    size_t origin = 0;    // posición de la muestra (0, 0, 0) dentro de pixels
+
+    // channels: número de canales por píxel según el tipo (P3/P6 a color, P2/P5 en grises)
+    int channels() const {
+        return (magic == "P3" || magic == "P6") ? 3 : 1;
+    }
+
+    // isBinary: P5/P6 guardan los píxeles en binario, P2/P3 en ASCII
+    bool isBinary() const {
+        return magic == "P5" || magic == "P6";
+    }
+
+    size_t strideBytes() const { return (size_t)stride * sizeof(int); }
+
+    // rowStride: muestras por fila con el relleno descrito arriba
+    static int rowStride(int samples) {
+        static const bool pad = rowPadding();
+        if (!pad) return samples;
+        int stride = (samples + 15) & ~15;                          // 16 int = 64 bytes
+        if (((size_t)stride * sizeof(int)) % 4096 == 0) stride += 16;
+        return stride;
+    }
+
+    static bool rowPadding() {
+        const char* env = std::getenv("FILTER_ROW_PAD");
+        return env == NULL || std::string(env) != "0";
+    }
+
+    // sizeFits: una imagen de tipo m y w x h píxeles con guard de borde se puede representar:
+    // dimensiones no negativas, y filas y stride con relleno (rowStride) dentro de int. Los
+    // anchos y altos de las cabeceras (PNM, PNG, QOI, .ptl) no son confiables; por eso
+    // allocate lo comprueba siempre en vez de dejarlo a cada formato
+    static bool sizeFits(const std::string& m, long long w, long long h, int guard = 0) {
+        long long canales = (m == "P3" || m == "P6") ? 3 : 1;
+        if (w < 0 || h < 0 || guard < 0 || guard > INT_MAX / 4) return false;
+        return (w + 2LL * guard) * canales + 31 <= INT_MAX && h + 2LL * guard <= INT_MAX;
+    }
+
+    // allocate: fija tipo y dimensiones y reserva el plano con borde y relleno, en cero.
+    // false, con la imagen vacía, si las dimensiones no entran (sizeFits) o no hay memoria
+    bool allocate(const std::string& m, long long w, long long h, int maxC, int guard = 0) {
+        magic = m;
+        maxColor = maxC;
+        if (sizeFits(m, w, h, guard)) {
+            width = (int)w;
+            height = (int)h;
+            border = guard;
+            stride = rowStride((width + 2 * guard) * channels());
+            origin = (size_t)guard * stride + (size_t)guard * channels();
+            try {
+                pixels.assign((size_t)stride * (height + 2 * guard), 0);
+                return true;
+            } catch (const std::bad_alloc&) {
+            }
+        }
+        pixels = PixelBuffer();
+        width = height = stride = border = 0;
+        origin = 0;
+        return false;
+    }
+
+    int* row(int y) { return pixels.data() + origin + (ptrdiff_t)y * stride; }
+    const int* row(int y) const { return pixels.data() + origin + (ptrdiff_t)y * stride; }
+
+    // view: la imagen completa como vista
+    ImageView view() {
+        ImageView v = {row(0), width, height, channels(), stride, maxColor, border};
+        return v;
+    }
+    ConstImageView view() const {
+        ConstImageView v = {row(0), width, height, channels(), stride, maxColor, border};
+        return v;
+    }
+
+    // load: carga una imagen desde un archivo .pgm o .ppm en memoria (P2, P3, P5 o P6),
+    // desde un contenedor por teselas .ptl (tiled.h) o desde PNG o QOI (codecs.h).
+    // La lectura del archivo cuenta como fase load y la conversión a píxeles como parse;
+    // los píxeles se contabilizan como memoria de entrada (memory.h)
+    // guard: píxeles de borde de guarda que se reservan alrededor (ver allocate)
+    bool load(const std::string& filename, PhaseTimer* timer = NULL, int guard = 0);
+
+    // parse: arma la imagen a partir del contenido de un archivo ya leído (lo que hace load
+    // después de readFile; el modo batch lee los archivos con bulkio.h). name sólo se usa
+    // en los mensajes de error
+    bool parse(const std::string& data, const std::string& name, PhaseTimer* timer = NULL, int guard = 0);
+
+    // save: guarda una imagen desde memoria a un archivo .pgm o .ppm; si el nombre termina
+    // en .ptl, como contenedor por teselas (tiled.h), y en .png o .qoi, con codecs.h
+    bool save(const std::string& filename) const;
+
+    // encode: el contenido del archivo que escribiría save
+    void encode(std::string& out) const;
+};
+
+#endif
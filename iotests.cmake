@@ -0,0 +1,217 @@
+# iotests.cmake: pruebas de ctest de los caminos de E/S que regression no recorre. Cada
+# caso convierte o filtra con los ejecutables recién compilados y compara los archivos
+# byte a byte con una referencia obtenida por otro camino.
+#
+#   cmake -DCASE=stream -DFILTER=build/filter -DPNMTILE=build/pnmtile -DPNMGEN=build/pnmgen
+#         -DPTHREADS=build/filter_phtreads -DSOURCE_DIR=. -DWORK_DIR=build/iotests/stream
+#         -P iotests.cmake
+#
+# Casos:
+#   stream   filter --stream con cada FILTER_STREAM_IO (buffered, mmap, direct) y dos
+#            alturas de banda, contra filter normal sobre la misma entrada P6
+#   tiled    PNM -> .ptl -> PNM con dos lados de tesela; --region de un .ptl contra el
+#            recorte de la imagen cargada entera; filter_phtreads con entrada .ptl (lectura
+#            por cuadrantes con halo) contra los archivos dorados; los .ptl dañados de
+#            pruebas/teselas rechazados con código 1 por pnmtile, filter y filter_phtreads
+#   codecs   PNG y QOI: los archivos de pruebas/codecs (generar.py) contra las muestras
+#            esperadas y los dañados (también los de dimensiones imposibles) rechazados con
+#            código 1 por pnmtile, filter y filter_phtreads; PNM -> PNG -> PNM y PNM -> QOI -> PNM
+#            exactos; filter y filter_phtreads con entrada .png o .qoi igual que con .ppm
+#   equalize equalize y clahe sobre las imágenes chicas de pruebas/ecualizacion contra las
+#            salidas de su generar.py: una constante, dos niveles por canal y CLAHE en
+#            grises y en color
+
+foreach(var CASE SOURCE_DIR WORK_DIR)
+  if(NOT ${var})
+    message(FATAL_ERROR "iotests: falta -D${var}")
+  endif()
+endforeach()
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+# correr: ejecuta el comando en WORK_DIR y corta la prueba si termina con error
+function(correr)
+  execute_process(COMMAND ${ARGN} WORKING_DIRECTORY "${WORK_DIR}" RESULT_VARIABLE status
+                  OUTPUT_VARIABLE salida ERROR_VARIABLE errores)
+  if(NOT status EQUAL 0)
+    string(REPLACE ";" " " comando "${ARGN}")
+    message(FATAL_ERROR "iotests: falló ${comando} (${status})\n${salida}${errores}")
+  endif()
+endfunction()
+
+# falla: el comando tiene que rechazar la entrada con código 1 (no caerse con una señal)
+function(falla)
+  execute_process(COMMAND ${ARGN} WORKING_DIRECTORY "${WORK_DIR}" RESULT_VARIABLE status
+                  OUTPUT_QUIET ERROR_QUIET)
+  if(NOT status STREQUAL "1")
+    string(REPLACE ";" " " comando "${ARGN}")
+    message(FATAL_ERROR "iotests: ${comando} tenía que fallar con 1 y dio ${status}")
+  endif()
+endfunction()
+
+# iguales: los dos archivos tienen que ser idénticos
+function(iguales referencia obtenido)
+  execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files "${referencia}" "${obtenido}"
+                  RESULT_VARIABLE distintos)
+  if(distintos)
+    message(FATAL_ERROR "iotests: ${obtenido} no coincide con ${referencia}")
+  endif()
+  message(STATUS "iotests: ${obtenido} == ${referencia}")
+endfunction()
+
+if(CASE STREQUAL "stream")
+  # puj.ppm es P3 y --stream sólo lee P5/P6. La sintética pasa los 4 MB de un bloque de
+  # O_DIRECT, y ninguna de las dos mide un múltiplo de 4 KB, así que el final del archivo
+  # va por el relleno y el truncate del modo direct
+  correr(${PNMTILE} "${SOURCE_DIR}/puj.ppm" puj6.ppm --magic P6)
+  correr(${PNMGEN} sint.ppm 1500x1001 --binary --seed 7)
+  foreach(entrada puj6 sint)
+    foreach(filtro blur gray+sharpen laplace,gamma:2.2)
+      string(REGEX REPLACE "[^a-z0-9]" "_" nombre "${entrada}_${filtro}")
+      correr(${FILTER} ${entrada}.ppm ${nombre}.ppm ${filtro})
+      foreach(io buffered mmap direct)
+        foreach(filas 64 7)
+          set(ENV{FILTER_STREAM_IO} ${io})
+          set(ENV{FILTER_STREAM_ROWS} ${filas})
+          correr(${FILTER} --stream ${entrada}.ppm ${nombre}_${io}_${filas}.ppm ${filtro})
+          iguales("${WORK_DIR}/${nombre}.ppm" "${WORK_DIR}/${nombre}_${io}_${filas}.ppm")
+        endforeach()
+      endforeach()
+    endforeach()
+  endforeach()
+elseif(CASE STREQUAL "tiled")
+  # La referencia de cada entrada es su propia conversión PNM -> PNM, así la comparación
+  # no depende de cómo estén partidas las líneas del P2/P3 original
+  correr(${PNMGEN} prof16.ppm 301x203 --maxval 4000 --binary --seed 3)
+  correr(${PNMGEN} prof10.pgm 190x77 --channels 1 --maxval 1000 --seed 5)
+  foreach(entrada "${SOURCE_DIR}/puj.ppm" "${SOURCE_DIR}/puj.pgm" prof16.ppm prof10.pgm)
+    get_filename_component(ext "${entrada}" EXT)
+    get_filename_component(nombre "${entrada}" NAME)
+    string(REPLACE "." "_" nombre "${nombre}")
+    correr(${PNMTILE} "${entrada}" ${nombre}_ref${ext})
+    foreach(tesela 256 37)
+      correr(${PNMTILE} "${entrada}" ${nombre}_${tesela}.ptl --tile ${tesela})
+      correr(${PNMTILE} ${nombre}_${tesela}.ptl ${nombre}_${tesela}${ext})
+      iguales("${WORK_DIR}/${nombre}_ref${ext}" "${WORK_DIR}/${nombre}_${tesela}${ext}")
+    endforeach()
+  endforeach()
+
+  # Regiones dentro de una tesela, cruzando varias, contra el borde derecho e inferior
+  # (teselas incompletas) y de un solo píxel
+  foreach(region 5,6,20,20 100,50,333,211 1883,563,37,37 0,0,1,1)
+    string(REPLACE "," "_" sufijo ${region})
+    correr(${PNMTILE} "${SOURCE_DIR}/puj.ppm" recorte_${sufijo}.ppm --region ${region})
+    foreach(tesela 256 37)
+      correr(${PNMTILE} puj_ppm_${tesela}.ptl region_${tesela}_${sufijo}.ppm --region ${region})
+      iguales("${WORK_DIR}/recorte_${sufijo}.ppm" "${WORK_DIR}/region_${tesela}_${sufijo}.ppm")
+    endforeach()
+  endforeach()
+
+  # Los dorados son P3 igual que la salida; se pasan los dos a P6 para comparar muestras
+  foreach(filtro laplace sharpen)
+    correr(${PTHREADS} puj_ppm_37.ptl pthreads_${filtro}.ppm ${filtro})
+    correr(${PNMTILE} pthreads_${filtro}.ppm pthreads_${filtro}_p6.ppm --magic P6)
+    correr(${PNMTILE} "${SOURCE_DIR}/puj_${filtro}.ppm" dorado_${filtro}_p6.ppm --magic P6)
+    iguales("${WORK_DIR}/dorado_${filtro}_p6.ppm" "${WORK_DIR}/pthreads_${filtro}_p6.ppm")
+  endforeach()
+
+  # Contenedores dañados de pruebas/teselas (generar.py): leídos enteros, por región (la
+  # región toca la última columna, que en malo_tesela.ptl es la tesela mala) y por
+  # cuadrantes
+  file(GLOB malos "${SOURCE_DIR}/pruebas/teselas/malo_*.ptl")
+  foreach(malo ${malos})
+    get_filename_component(nombre "${malo}" NAME_WE)
+    falla(${PNMTILE} "${malo}" ${nombre}.pgm)
+    falla(${PNMTILE} "${malo}" ${nombre}_region.pgm --region 4095,0,1,1)
+    falla(${FILTER} "${malo}" ${nombre}_filter.pgm blur)
+    falla(${PTHREADS} "${malo}" ${nombre}_pthreads.pgm blur)
+  endforeach()
+elseif(CASE STREQUAL "codecs")
+  set(corpus "${SOURCE_DIR}/pruebas/codecs")
+  file(GLOB archivos RELATIVE "${corpus}" "${corpus}/*.png" "${corpus}/*.qoi")
+  foreach(archivo ${archivos})
+    string(REGEX REPLACE "\\.(png|qoi)$" "" nombre "${archivo}")
+    if(nombre MATCHES "^malo_")
+      falla(${PNMTILE} "${corpus}/${archivo}" ${nombre}.pnm)
+      falla(${FILTER} "${corpus}/${archivo}" ${nombre}_filter.pnm blur)
+      falla(${PTHREADS} "${corpus}/${archivo}" ${nombre}_pthreads.pnm blur)
+    else()
+      string(REPLACE "." "_" salida "${archivo}")
+      correr(${PNMTILE} "${corpus}/${archivo}" ${salida}.pnm)
+      iguales("${corpus}/${nombre}.pnm" "${WORK_DIR}/${salida}.pnm")
+    endif()
+  endforeach()
+  correr(${PNMTILE} "${corpus}/opaco.pnm" opaco.qoi)
+  iguales("${corpus}/opaco.qoi" "${WORK_DIR}/opaco.qoi")
+
+  # Ida y vuelta por PNG: 8 bits, 16 bits completos y maxval que no son 255 ni 65535 (van
+  # escalados con el maxval original en pnMx), en color y en grises
+  correr(${PNMGEN} prof16.ppm 301x203 --maxval 4000 --binary --seed 3)
+  correr(${PNMGEN} full16.pgm 97x61 --channels 1 --maxval 65535 --binary --seed 4)
+  correr(${PNMGEN} prof10.pgm 190x77 --channels 1 --maxval 1000 --seed 5)
+  correr(${PNMGEN} max200.ppm 64x33 --maxval 200 --binary --seed 6)
+  foreach(entrada "${SOURCE_DIR}/puj.ppm" "${SOURCE_DIR}/puj.pgm" prof16.ppm full16.pgm prof10.pgm max200.ppm)
+    get_filename_component(ext "${entrada}" EXT)
+    get_filename_component(nombre "${entrada}" NAME)
+    string(REPLACE "." "_" nombre "${nombre}")
+    if(NOT IS_ABSOLUTE "${entrada}")
+      set(entrada "${WORK_DIR}/${entrada}")
+    endif()
+    file(READ "${entrada}" magic LIMIT 2)
+    string(SUBSTRING "${magic}" 0 2 magic)
+    correr(${PNMTILE} "${entrada}" ${nombre}_ref${ext})
+    correr(${PNMTILE} "${entrada}" ${nombre}.png)
+    correr(${PNMTILE} ${nombre}.png ${nombre}_png${ext} --magic ${magic})
+    iguales("${WORK_DIR}/${nombre}_ref${ext}" "${WORK_DIR}/${nombre}_png${ext}")
+  endforeach()
+
+  # QOI sólo guarda RGB de 8 bits: puj.ppm vuelve exacta, puj.pgm vuelve como RGB con los
+  # tres canales iguales (gray la devuelve a grises sin cambios) y 16 bits se rechaza
+  correr(${PNMTILE} "${SOURCE_DIR}/puj.ppm" puj.qoi)
+  correr(${PNMTILE} puj.qoi puj_qoi.ppm --magic P3)
+  iguales("${WORK_DIR}/puj_ppm_ref.ppm" "${WORK_DIR}/puj_qoi.ppm")
+  correr(${PNMTILE} "${SOURCE_DIR}/puj.pgm" pujgris.qoi)
+  correr(${FILTER} pujgris.qoi pujgris_qoi.pgm gray)
+  correr(${PNMTILE} pujgris_qoi.pgm pujgris_qoi_p2.pgm --magic P2)
+  iguales("${WORK_DIR}/puj_pgm_ref.pgm" "${WORK_DIR}/pujgris_qoi_p2.pgm")
+  falla(${PNMTILE} prof16.ppm prof16.qoi)
+
+  # Los backends con entrada .png y .qoi dan lo mismo que con el .ppm; las salidas se pasan
+  # a P6 porque heredan el tipo de la entrada
+  foreach(filtro blur laplace)
+    foreach(backend FILTER PTHREADS)
+      foreach(ext ppm png qoi)
+        if(ext STREQUAL "ppm")
+          set(entrada "${SOURCE_DIR}/puj.ppm")
+        elseif(ext STREQUAL "png")
+          set(entrada puj_ppm.png)
+        else()
+          set(entrada puj.qoi)
+        endif()
+        correr(${${backend}} "${entrada}" ${backend}_${filtro}_${ext}.ppm ${filtro})
+        correr(${PNMTILE} ${backend}_${filtro}_${ext}.ppm ${backend}_${filtro}_${ext}_p6.ppm --magic P6)
+      endforeach()
+      iguales("${WORK_DIR}/${backend}_${filtro}_ppm_p6.ppm" "${WORK_DIR}/${backend}_${filtro}_png_p6.ppm")
+      iguales("${WORK_DIR}/${backend}_${filtro}_ppm_p6.ppm" "${WORK_DIR}/${backend}_${filtro}_qoi_p6.ppm")
+    endforeach()
+  endforeach()
+elseif(CASE STREQUAL "equalize")
+  # Salidas de pruebas/ecualizacion (generar.py) calculadas sin filter.cpp; la imagen
+  # constante tiene que volver igual. Las dos se pasan por pnmtile para comparar muestras
+  set(corpus "${SOURCE_DIR}/pruebas/ecualizacion")
+  foreach(caso "constante.pgm equalize constante.pgm" "dos_niveles.ppm equalize dos_niveles_equalize.ppm"
+               "clahe_gris.pgm clahe clahe_gris_clahe.pgm" "clahe_color.ppm clahe clahe_color_clahe.ppm")
+    separate_arguments(caso)
+    list(GET caso 0 entrada)
+    list(GET caso 1 filtro)
+    list(GET caso 2 esperado)
+    get_filename_component(ext "${entrada}" EXT)
+    get_filename_component(nombre "${entrada}" NAME_WE)
+    correr(${FILTER} "${corpus}/${entrada}" ${nombre}_${filtro}${ext} ${filtro})
+    correr(${PNMTILE} ${nombre}_${filtro}${ext} ${nombre}_${filtro}_obtenido${ext})
+    correr(${PNMTILE} "${corpus}/${esperado}" ${nombre}_${filtro}_esperado${ext})
+    iguales("${WORK_DIR}/${nombre}_${filtro}_esperado${ext}" "${WORK_DIR}/${nombre}_${filtro}_obtenido${ext}")
+  endforeach()
+else()
+  message(FATAL_ERROR "iotests: caso desconocido ${CASE}")
+endif()
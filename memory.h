@@ -0,0 +1,60 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+// memory.h: contabilidad de memoria por categoría de búfer y pico de RSS del proceso.
+// Cada backend suma los bytes que reserva para cada búfer grande (el archivo leído, la
+// imagen de entrada, las salidas, los temporales de los filtros y los búferes de
+// comunicación de MPI) y timing.h los incluye en la línea JSON junto con el pico de RSS,
+// para dimensionar los trabajos y comprobar que las reducciones de memoria funcionan.
+// Los contadores son atómicos porque los filtros con OpenMP reservan desde varios hilos.
+
+#include <atomic>
+#include <vector>
+#include <sys/resource.h>
+
+enum MemCategory { MEM_FILE, MEM_INPUT, MEM_OUTPUT, MEM_SCRATCH, MEM_COMM, NUM_MEM_CATEGORIES };
+
+inline const char* memCategoryName(int c) {
+    static const char* names[NUM_MEM_CATEGORIES] = {"file", "input", "output", "scratch", "comm"};
+    return names[c];
+}
+
+// vectorBytes: memoria que ocupa realmente el vector (capacidad, no tamaño)
+template <class T, class A>
+inline long long vectorBytes(const std::vector<T, A>& v) {
+    return (long long)v.capacity() * sizeof(T);
+}
+
+class MemoryStats {
+    std::atomic<long long> bytes[NUM_MEM_CATEGORIES];
+
+    MemoryStats() {
+        for (int c = 0; c < NUM_MEM_CATEGORIES; c++) bytes[c] = 0;
+    }
+public:
+    static MemoryStats& instance() {
+        static MemoryStats stats;
+        return stats;
+    }
+
+    // add: bytes reservados en la categoría (se acumulan, no se descuentan al liberar)
+    void add(MemCategory c, long long n) { bytes[c] += n; }
+    long long get(MemCategory c) const { return bytes[c]; }
+    // set: reemplaza el total, por ejemplo con la suma de todos los ranks de MPI
+    void set(MemCategory c, long long n) { bytes[c] = n; }
+
+    long long total() const {
+        long long t = 0;
+        for (int c = 0; c < NUM_MEM_CATEGORIES; c++) t += bytes[c];
+        return t;
+    }
+};
+
+// peakRssBytes: máximo de memoria residente del proceso hasta ahora (ru_maxrss en KB)
+inline long long peakRssBytes() {
+    struct rusage uso;
+    if (getrusage(RUSAGE_SELF, &uso) != 0) return -1;
+    return (long long)uso.ru_maxrss * 1024;
+}
+
+#endif
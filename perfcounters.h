@@ -0,0 +1,156 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+// perfcounters.h: contadores de hardware con perf_event_open alrededor de los ciclos
+// calientes. Sólo se activan si la variable de entorno FILTER_PERF está definida; si el
+// kernel no los permite (perf_event_paranoid, contenedores) las lecturas quedan inválidas
+// y el filtro corre igual.
+// Cada hilo abre sus propios contadores (pid = 0, cpu = -1 mide sólo al hilo que llama);
+// con inherit también se cuentan los hilos que ese hilo cree mientras están abiertos.
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include "timing.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum Counter { CNT_CYCLES, CNT_INSTRUCTIONS, CNT_L1D_MISSES, CNT_LLC_MISSES, CNT_BRANCH_MISSES, NUM_COUNTERS };
+
+inline const char* counterName(int c) {
+    static const char* names[NUM_COUNTERS] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+    return names[c];
+}
+
+// PerfSample: valores acumulados; un contador en -1 no estuvo disponible
+struct PerfSample {
+    long long values[NUM_COUNTERS];
+
+    PerfSample() { for (int c = 0; c < NUM_COUNTERS; c++) values[c] = -1; }
+
+    bool valid() const { return values[CNT_CYCLES] > 0; }
+
+    void add(const PerfSample& other) {
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            if (other.values[c] < 0) continue;
+            values[c] = (values[c] < 0 ? 0 : values[c]) + other.values[c];
+        }
+    }
+
+    double ipc() const {
+        if (!valid() || values[CNT_INSTRUCTIONS] < 0) return 0.0;
+        return (double)values[CNT_INSTRUCTIONS] / values[CNT_CYCLES];
+    }
+
+    // bytesPerCycle: bytes que el filtro debe mover como mínimo (leer la entrada y
+    // escribir la salida) sobre los ciclos medidos
+    double bytesPerCycle(long long bytes) const {
+        if (!valid()) return 0.0;
+        return (double)bytes / values[CNT_CYCLES];
+    }
+};
+
+inline bool perfRequested() {
+    const char* v = std::getenv("FILTER_PERF");
+    return v != NULL && *v != '\0' && std::string(v) != "0";
+}
+
+class PerfCounters {
+    int fds[NUM_COUNTERS];
+public:
+    PerfCounters() { for (int c = 0; c < NUM_COUNTERS; c++) fds[c] = -1; }
+    ~PerfCounters() { close(); }
+
+    // start: abre y pone en cero los contadores del hilo actual
+    void start(bool inherit = false) {
+#ifdef __linux__
+        if (!perfRequested()) return;
+        static const unsigned long long configs[NUM_COUNTERS][2] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = (unsigned)configs[c][0];
+            attr.config = configs[c][1];
+            attr.disabled = 1;
+            attr.inherit = inherit ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[c] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            if (fds[c] < 0) continue;
+            ioctl(fds[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#else
+        (void)inherit;
+#endif
+    }
+
+    // stop: detiene los contadores y devuelve lo medido, escalado si el kernel tuvo
+    // que multiplexarlos
+    PerfSample stop() {
+        PerfSample s;
+#ifdef __linux__
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            if (fds[c] >= 0) ioctl(fds[c], PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            if (fds[c] < 0) continue;
+            unsigned long long data[3] = {0, 0, 0};
+            if (read(fds[c], data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0) continue;
+            s.values[c] = (long long)((double)data[0] * data[1] / data[2]);
+        }
+#endif
+        close();
+        return s;
+    }
+
+    void close() {
+#ifdef __linux__
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            if (fds[c] >= 0) ::close(fds[c]);
+            fds[c] = -1;
+        }
+#endif
+    }
+};
+
+// reportCounters: agrega los contadores al registro JSON y escribe un resumen legible.
+// bytes es el tráfico mínimo del filtro (entrada + salida).
+inline void reportCounters(PhaseTimer& timer, const std::string& label, const PerfSample& s, long long bytes) {
+    if (!perfRequested()) return;
+    if (!s.valid()) {
+        std::cout << "Contadores " << label << ": no disponibles (perf_event_open falló)\n";
+        return;
+    }
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (s.values[c] >= 0) timer.addMetric(counterName(c), (double)s.values[c]);
+    }
+    timer.addMetric("ipc", s.ipc());
+    timer.addMetric("bytes_per_cycle", s.bytesPerCycle(bytes));
+
+    std::ostringstream out;
+    out << "Contadores " << label << ": IPC " << s.ipc() << ", bytes/ciclo " << s.bytesPerCycle(bytes);
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (s.values[c] >= 0) out << ", " << counterName(c) << " " << s.values[c];
+    }
+    std::cout << out.str() << "\n";
+}
+
+#endif
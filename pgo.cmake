@@ -0,0 +1,89 @@
+# pgo.cmake: optimización guiada por perfil de punta a punta, con números de antes y después.
+#
+#   cmake --build build --target pgo
+#   cmake -DSOURCE_DIR=. -DWORK_DIR=build/pgo -P pgo.cmake      (sin configurar antes)
+#
+# Pasos, todos dentro de WORK_DIR:
+#   1. base/   compilación Release normal, la referencia del "antes"
+#   2. build/  compilación instrumentada (FILTER_PGO=GENERATE)
+#   3. entrenamiento: los tres filtros en todos los backends sobre puj.ppm y puj.pgm
+#   4. build/  se recompila en el mismo directorio con FILTER_PGO=USE; gcc busca cada
+#              perfil por la ruta del objeto, por eso generar y usar comparten carpeta
+#   5. benchmark de base/ y de build/ con --compare: columnas "vs base" y "wall vs"
+#
+# Variables: SOURCE_DIR, WORK_DIR, FILTER_NATIVE, FILTER_LTO (se pasan a las dos
+# compilaciones para que sólo cambie el perfil), REPEAT (muestras por caso, 5).
+
+if(NOT SOURCE_DIR)
+  set(SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}")
+endif()
+get_filename_component(SOURCE_DIR "${SOURCE_DIR}" ABSOLUTE)
+if(NOT WORK_DIR)
+  set(WORK_DIR "${SOURCE_DIR}/build/pgo")
+endif()
+get_filename_component(WORK_DIR "${WORK_DIR}" ABSOLUTE)
+if(NOT REPEAT)
+  set(REPEAT 5)
+endif()
+
+set(common_args -DCMAKE_BUILD_TYPE=Release)
+foreach(opcion FILTER_NATIVE FILTER_LTO)
+  if(DEFINED ${opcion})
+    list(APPEND common_args -D${opcion}=${${opcion}})
+  endif()
+endforeach()
+
+include(ProcessorCount)
+ProcessorCount(jobs)
+if(jobs EQUAL 0)
+  set(jobs 1)
+endif()
+
+function(paso descripcion)
+  message(STATUS "pgo: ${descripcion}")
+  execute_process(COMMAND ${ARGN} RESULT_VARIABLE status)
+  if(NOT status EQUAL 0)
+    message(FATAL_ERROR "pgo: falló \"${descripcion}\" (${status})")
+  endif()
+endfunction()
+
+function(compilar dir)
+  paso("configurar ${dir}" ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${dir} ${common_args} ${ARGN})
+  paso("compilar ${dir}" ${CMAKE_COMMAND} --build ${dir} -j ${jobs})
+endfunction()
+
+# backend_args: ejecutables de una compilación para benchmark
+function(backends dir out)
+  set(args --serial ${dir}/filter --pthreads ${dir}/filter_phtreads --mpirun "mpirun --oversubscribe")
+  foreach(b omp MPI)
+    if(EXISTS ${dir}/filter_${b})
+      string(TOLOWER ${b} nombre)
+      list(APPEND args --${nombre} ${dir}/filter_${b})
+    endif()
+  endforeach()
+  set(${out} ${args} PARENT_SCOPE)
+endfunction()
+
+set(inputs ${SOURCE_DIR}/puj.ppm,${SOURCE_DIR}/puj.pgm)
+set(profiles ${WORK_DIR}/profiles)
+
+compilar(${WORK_DIR}/base -DFILTER_PGO=OFF)
+
+# Perfiles viejos de otra versión del código harían que gcc descarte o mezcle contadores
+file(REMOVE_RECURSE ${profiles})
+compilar(${WORK_DIR}/build -DFILTER_PGO=GENERATE -DFILTER_PGO_DIR=${profiles})
+backends(${WORK_DIR}/build train_args)
+paso("entrenamiento" ${WORK_DIR}/build/benchmark ${train_args} --inputs ${inputs}
+     --workers 1,2,4 --warmup 0 --repeat 1)
+
+compilar(${WORK_DIR}/build -DFILTER_PGO=USE -DFILTER_PGO_DIR=${profiles})
+
+backends(${WORK_DIR}/base base_args)
+paso("benchmark sin PGO" ${WORK_DIR}/base/benchmark ${base_args} --inputs ${inputs}
+     --repeat ${REPEAT} --csv ${WORK_DIR}/base.csv)
+backends(${WORK_DIR}/build pgo_args)
+paso("benchmark con PGO" ${WORK_DIR}/build/benchmark ${pgo_args} --inputs ${inputs}
+     --repeat ${REPEAT} --compare ${WORK_DIR}/base.csv --csv ${WORK_DIR}/pgo.csv)
+
+message(STATUS "pgo: binarios optimizados en ${WORK_DIR}/build; resultados en "
+               "${WORK_DIR}/base.csv y ${WORK_DIR}/pgo.csv (compute_gain, wall_gain > 1 = mejora)")
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include "synthetic.h"
+
+using namespace std;
+
+// pnmgen: genera imágenes de prueba grandes para los benchmarks sin guardarlas en el repo.
+//
+// Uso: ./pnmgen salida.ppm TAMAÑO [opciones]
+//   TAMAÑO                         ANCHOxALTO, 8k, 16k o gigapixel
+//   --channels 1|3                 grises o color (por defecto 3)
+//   --maxval N                     valor máximo, hasta 65535 (más de 255 usa 2 bytes en binario)
+//   --pattern noise|gradient|checker
+//   --cell N                       lado de las casillas del tablero
+//   --seed N                       semilla del ruido
+//   --binary                       P5/P6 en vez de P2/P3
+//   --threads N                    hilos que formatean las bandas
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Uso: " << argv[0] << " salida.ppm ANCHOxALTO|8k|16k|gigapixel [--channels 1|3] [--maxval N]"
+             << " [--pattern noise|gradient|checker] [--cell N] [--seed N] [--binary] [--threads N]\n";
+        return 1;
+    }
+
+    SyntheticSpec spec;
+    string path = argv[1];
+    if (!parseSize(argv[2], spec.width, spec.height)) {
+        cerr << "Tamaño inválido: " << argv[2] << "\n";
+        return 1;
+    }
+
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--binary") {
+            spec.binary = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Falta el valor de " << arg << "\n";
+            return 1;
+        }
+        string valor = argv[++i];
+        if (arg == "--channels") spec.channels = atoi(valor.c_str());
+        else if (arg == "--maxval") spec.maxColor = atoi(valor.c_str());
+        else if (arg == "--pattern") spec.pattern = valor;
+        else if (arg == "--cell") spec.cell = atoi(valor.c_str());
+        else if (arg == "--seed") spec.seed = strtoull(valor.c_str(), NULL, 10);
+        else if (arg == "--threads") spec.threads = atoi(valor.c_str());
+        else {
+            cerr << "Opción desconocida: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    if (!writeSynthetic(path, spec)) {
+        cerr << "No se pudo generar " << path << " (revisar tamaño, canales, maxval y patrón)\n";
+        return 1;
+    }
+    chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+    cout << "Imagen generada: " << path << " (" << spec.width << "x" << spec.height << "x" << spec.channels
+         << ", " << spec.pattern << ") en " << elapsed.count() << " s\n";
+    return 0;
+}
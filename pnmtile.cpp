@@ -0,0 +1,98 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <sys/stat.h>
+#include "image.h"
+#include "tiled.h"
+
+using namespace std;
+
+// pnmtile: convierte entre PNM (P2/P3/P5/P6), el contenedor por teselas .ptl (tiled.h), PNG
+// y QOI (codecs.h). La entrada se reconoce por su contenido y la salida por la extensión:
+// .ptl, .png o .qoi, y cualquier otra escribe PNM con el tipo de la entrada (o el de
+// --magic; PNG y QOI se leen como P5/P6).
+//
+// Uso: ./pnmtile entrada salida [opciones]
+//   --tile N                       lado de las teselas al escribir .ptl (por defecto 256)
+//   --magic P2|P3|P5|P6            tipo PNM de la salida (los canales deben coincidir)
+//   --region X,Y,ANCHO,ALTO        sólo ese rectángulo; de un .ptl se leen nada más que
+//                                  las teselas que toca, los demás formatos se cargan
+//                                  enteros y se recortan (la referencia de las pruebas)
+
+static long long tamArchivo(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long long)st.st_size : -1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Uso: " << argv[0] << " entrada salida [--tile N] [--magic P2|P3|P5|P6]"
+             << " [--region X,Y,ANCHO,ALTO]\n";
+        return 1;
+    }
+    string entrada = argv[1], salida = argv[2];
+    string magic;
+    int region[4] = {-1, -1, -1, -1};
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Falta el valor de " << arg << "\n";
+            return 1;
+        }
+        string valor = argv[++i];
+        if (arg == "--tile") setenv("FILTER_TILE_SIZE", valor.c_str(), 1);
+        else if (arg == "--magic") magic = valor;
+        else if (arg == "--region") {
+            if (sscanf(valor.c_str(), "%d,%d,%d,%d", &region[0], &region[1], &region[2], &region[3]) != 4) {
+                cerr << "Región inválida: " << valor << "\n";
+                return 1;
+            }
+        } else {
+            cerr << "Opción desconocida: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    Image img;
+    TileContainer tiles;
+    if (region[0] >= 0 && tiles.open(entrada)) {
+        if (!tiles.readRegion(region[0], region[1], region[2], region[3], 0, img)) {
+            cerr << "Región fuera de la imagen\n";
+            return 1;
+        }
+        cout << "Teselas leídas: " << tiles.getTilesRead() << " de " << tiles.header().tiles() << " ("
+             << tiles.getBytesRead() << " bytes)\n";
+    } else if (!img.load(entrada)) {
+        return 1;
+    } else if (region[0] >= 0) {
+        int x = region[0], y = region[1], w = region[2], h = region[3];
+        if (y < 0 || w <= 0 || h <= 0 || (long long)x + w > img.width || (long long)y + h > img.height) {
+            cerr << "Región fuera de la imagen\n";
+            return 1;
+        }
+        ConstImageView recorte = static_cast<const Image&>(img).view().sub(x, y, w, h);
+        Image parte;
+        parte.allocate(img.magic, w, h, img.maxColor);
+        for (int f = 0; f < h; f++) copy(recorte.row(f), recorte.row(f) + w * recorte.channels, parte.row(f));
+        img = std::move(parte);
+    }
+    if (!magic.empty()) {
+        bool color = magic == "P3" || magic == "P6";
+        bool valido = magic == "P2" || magic == "P3" || magic == "P5" || magic == "P6";
+        if (!valido || (color ? 3 : 1) != img.channels()) {
+            cerr << "Tipo no compatible con la imagen: " << magic << "\n";
+            return 1;
+        }
+        img.magic = magic;
+    }
+    if (!img.save(salida)) return 1;
+
+    chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+    cout << entrada << " (" << tamArchivo(entrada) << " bytes) -> " << salida << " (" << tamArchivo(salida)
+         << " bytes) en " << elapsed.count() << " s\n";
+    return 0;
+}
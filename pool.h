@@ -0,0 +1,168 @@
+#ifndef POOL_H
+#define POOL_H
+
+// pool.h: pool de búferes para los planos de píxeles. Image::pixels y las salidas de los
+// filtros usan PoolAllocator, así que un búfer liberado vuelve a una lista libre según su
+// clase de tamaño y la siguiente imagen del mismo tamaño lo reutiliza sin pedir memoria al
+// sistema: procesando lotes o cuadros de video, después del primero no hay reservas nuevas.
+//
+// Las clases de tamaño parten cada potencia de dos en cuatro (desperdicio máximo del 25 %),
+// con un mínimo de 4 KB. Todos los bloques quedan alineados a 64 bytes para SIMD.
+// Páginas grandes para los bloques de 2 MB o más (imágenes de gigapíxeles, donde los
+// accesos de fila en fila de la convolución fallan mucho en la TLB):
+//   FILTER_HUGEPAGES=1 o thp   alineados a 2 MB y marcados con madvise(MADV_HUGEPAGE)
+//                              para que el kernel los respalde con THP
+//   FILTER_HUGEPAGES=hugetlb   mmap con MAP_HUGETLB, páginas de 2 MB reservadas en
+//                              hugetlbfs (vm.nr_hugepages); si no hay, se usa THP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+
+class PixelPool {
+    static const int MIN_SHIFT = 12;   // clase mínima: 4 KB
+    static const int NUM_CLASSES = 1 + 4 * (64 - MIN_SHIFT);
+    static const size_t CACHE_LINE = 64;
+    static const size_t HUGE_PAGE = 2 << 20;
+
+    std::mutex mtx;
+    std::vector<void*> libres[NUM_CLASSES];
+    enum HugeMode { HUGE_OFF, HUGE_THP, HUGE_TLB };
+    HugeMode hugePages;
+    std::set<void*> mapeados;   // bloques de hugetlbfs: se liberan con munmap
+    std::atomic<long long> requests, reused, cachedBytes;
+
+    PixelPool() : requests(0), reused(0), cachedBytes(0) {
+        const char* env = std::getenv("FILTER_HUGEPAGES");
+        std::string modo = env ? env : "";
+        if (modo == "hugetlb") hugePages = HUGE_TLB;
+        else if (modo.empty() || modo == "0") hugePages = HUGE_OFF;
+        else hugePages = HUGE_THP;
+    }
+
+    static size_t redondearHuge(size_t tam) {
+        return (tam + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+    }
+
+    // clase: índice de la lista libre y tamaño real del bloque para una petición
+    static int clase(size_t bytes, size_t& tam) {
+        if (bytes <= ((size_t)1 << MIN_SHIFT)) {
+            tam = (size_t)1 << MIN_SHIFT;
+            return 0;
+        }
+        // 2^e < bytes <= 2^(e+1); el intervalo se parte en cuatro pasos de 2^(e-2)
+        int e = 63 - __builtin_clzll((unsigned long long)(bytes - 1));
+        size_t paso = (size_t)1 << (e - 2);
+        size_t sub = (bytes - 1 - ((size_t)1 << e)) / paso;
+        tam = ((size_t)1 << e) + (sub + 1) * paso;
+        return 1 + 4 * (e - MIN_SHIFT) + (int)sub;
+    }
+
+    // tamClase: tamaño de los bloques de la clase c (inversa de clase)
+    static size_t tamClase(int c) {
+        if (c == 0) return (size_t)1 << MIN_SHIFT;
+        int e = MIN_SHIFT + (c - 1) / 4;
+        return ((size_t)1 << e) + (size_t)((c - 1) % 4 + 1) * ((size_t)1 << (e - 2));
+    }
+
+public:
+    // instance: el pool nunca se destruye, así los vectores estáticos que se liberen al
+    // salir del programa no devuelven bloques a un pool ya destruido
+    static PixelPool& instance() {
+        static PixelPool* pool = new PixelPool();
+        return *pool;
+    }
+
+    void* allocate(size_t bytes) {
+        size_t tam;
+        int c = clase(bytes, tam);
+        requests++;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!libres[c].empty()) {
+                void* p = libres[c].back();
+                libres[c].pop_back();
+                reused++;
+                cachedBytes -= (long long)tam;
+                return p;
+            }
+        }
+        bool grande = hugePages != HUGE_OFF && tam >= HUGE_PAGE;
+#ifdef MAP_HUGETLB
+        if (grande && hugePages == HUGE_TLB) {
+            void* m = mmap(NULL, redondearHuge(tam), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (m != MAP_FAILED) {
+                std::lock_guard<std::mutex> lock(mtx);
+                mapeados.insert(m);
+                return m;
+            }
+        }
+#endif
+        void* p = NULL;
+        if (posix_memalign(&p, grande ? HUGE_PAGE : CACHE_LINE, tam) != 0) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+        if (grande) madvise(p, tam, MADV_HUGEPAGE);
+#endif
+        return p;
+    }
+
+    void deallocate(void* p, size_t bytes) {
+        if (p == NULL) return;
+        size_t tam;
+        int c = clase(bytes, tam);
+        std::lock_guard<std::mutex> lock(mtx);
+        libres[c].push_back(p);
+        cachedBytes += (long long)tam;
+    }
+
+    // trim: devuelve al sistema todos los bloques libres
+    void trim() {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (int c = 0; c < NUM_CLASSES; c++) {
+            for (size_t i = 0; i < libres[c].size(); i++) {
+                void* p = libres[c][i];
+                if (mapeados.erase(p) > 0) {
+                    munmap(p, redondearHuge(tamClase(c)));
+                } else {
+                    free(p);
+                }
+            }
+            libres[c].clear();
+        }
+        cachedBytes = 0;
+    }
+
+    long long getRequests() const { return requests; }
+    long long getReused() const { return reused; }
+    long long getCachedBytes() const { return cachedBytes; }
+};
+
+// PoolAllocator: asignador sin estado para std::vector que pide los bloques a PixelPool
+template <class T>
+struct PoolAllocator {
+    typedef T value_type;
+
+    PoolAllocator() {}
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t n) { return (T*)PixelPool::instance().allocate(n * sizeof(T)); }
+    void deallocate(T* p, size_t n) { PixelPool::instance().deallocate(p, n * sizeof(T)); }
+};
+
+template <class T, class U>
+inline bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+template <class T, class U>
+inline bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+// PixelBuffer: tipo de los planos de píxeles de Image y de los búferes de salida
+typedef std::vector<int, PoolAllocator<int> > PixelBuffer;
+
+#endif
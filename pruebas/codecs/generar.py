@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+# generar.py: archivos PNG y QOI de prueba para iotests.cmake (caso codecs), escritos sin
+# pasar por codecs.cpp. Cada <nombre>.png / <nombre>.qoi va con el <nombre>.pnm que tiene
+# que dar al leerlo (las muestras se calculan acá, no con el decodificador que se prueba),
+# y los malo_*.png / malo_*.qoi tienen que rechazarse. opaco.qoi es además lo que tiene
+# que escribir QoiCodec::encode para opaco.pnm. Sólo usa la biblioteca estándar.
+#
+#   python3 generar.py [carpeta]        (por defecto la carpeta del script)
+#
+# Las imágenes son chicas y de ancho impar, así las filas de 1, 2 y 4 bits terminan con
+# bits de relleno; cada fila usa un filtro distinto (0 a 4) y el nivel de zlib alterna
+# entre 0 (bloques almacenados) y 9 (Huffman fijo o dinámico).
+
+import os
+import struct
+import sys
+import zlib
+
+ANCHO, ALTO = 13, 7
+
+
+def bloque(tipo, datos):
+    return struct.pack(">I", len(datos)) + tipo + datos + struct.pack(">I", zlib.crc32(tipo + datos) & 0xffffffff)
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def filtrar(filas, bpp):
+    """Aplica a la fila y el filtro y % 5 y devuelve el flujo sin comprimir."""
+    salida = bytearray()
+    previa = bytes(len(filas[0]))
+    for y, fila in enumerate(filas):
+        f = y % 5
+        salida.append(f)
+        for i, x in enumerate(fila):
+            a = fila[i - bpp] if i >= bpp else 0
+            b = previa[i]
+            c = previa[i - bpp] if i >= bpp else 0
+            pred = [0, a, b, (a + b) // 2, paeth(a, b, c)][f]
+            salida.append((x - pred) & 0xff)
+        previa = fila
+    return bytes(salida)
+
+
+def png(tipo, depth, filas, bpp, nivel, paleta=None, partes=1):
+    ihdr = struct.pack(">IIBBBBB", ANCHO, ALTO, depth, tipo, 0, 0, 0)
+    comprimido = zlib.compress(filtrar(filas, bpp), nivel)
+    datos = b"\x89PNG\r\n\x1a\n" + bloque(b"IHDR", ihdr)
+    if paleta is not None:
+        datos += bloque(b"PLTE", bytes(paleta))
+    paso = (len(comprimido) + partes - 1) // partes
+    for i in range(0, len(comprimido), paso):
+        datos += bloque(b"IDAT", comprimido[i:i + paso])
+    return datos + bloque(b"IEND", b"")
+
+
+def pnm(canales, maxval, muestras):
+    cabecera = ("P6" if canales == 3 else "P5") + "\n%d %d\n%d\n" % (ANCHO, ALTO, maxval)
+    if maxval < 256:
+        cuerpo = bytes(muestras)
+    else:
+        cuerpo = b"".join(struct.pack(">H", v) for v in muestras)
+    return cabecera.encode() + cuerpo
+
+
+def empaquetar(valores, depth):
+    """Una fila de valores de depth bits, del bit más alto al más bajo."""
+    fila = bytearray((len(valores) * depth + 7) // 8)
+    for x, v in enumerate(valores):
+        bit = x * depth
+        fila[bit // 8] |= v << (8 - depth - bit % 8)
+    return bytes(fila)
+
+
+def valor(x, y, c, maxval):
+    return (x * 37 + y * 91 + c * 53 + x * y * 7) % (maxval + 1)
+
+
+def casos_png():
+    casos = {}
+    nivel = [0, 9]
+    n = 0
+
+    def agregar(nombre, datos, esperado):
+        casos[nombre + ".png"] = datos
+        casos[nombre + ".pnm"] = esperado
+
+    # Grises de 1 a 16 bits (tipo 0): P5 con maxval 2^depth - 1
+    for depth in (1, 2, 4, 8, 16):
+        maxval = (1 << depth) - 1
+        muestras, filas = [], []
+        for y in range(ALTO):
+            fila = [valor(x, y, 0, maxval) for x in range(ANCHO)]
+            muestras += fila
+            if depth < 8:
+                filas.append(empaquetar(fila, depth))
+            else:
+                filas.append(b"".join(struct.pack(">H" if depth == 16 else "B", v) for v in fila))
+        agregar("gris%d" % depth, png(0, depth, filas, max(1, depth // 8), nivel[n % 2]),
+                pnm(1, maxval, muestras))
+        n += 1
+
+    # Paleta de 1 a 8 bits (tipo 3): P6 de 8 bits con los colores de la paleta
+    for depth in (1, 2, 4, 8):
+        colores = min(1 << depth, 200)
+        paleta = []
+        for i in range(colores):
+            paleta += [(i * 67) % 256, (i * 151 + 30) % 256, (255 - i * 13) % 256]
+        muestras, filas = [], []
+        for y in range(ALTO):
+            indices = [valor(x, y, 0, 255) % colores for x in range(ANCHO)]
+            for i in indices:
+                muestras += paleta[3 * i:3 * i + 3]
+            filas.append(empaquetar(indices, depth) if depth < 8 else bytes(indices))
+        agregar("paleta%d" % depth, png(3, depth, filas, 1, nivel[n % 2], paleta), pnm(3, 255, muestras))
+        n += 1
+
+    # RGB (tipo 2), gris con alfa (4) y RGBA (6) de 8 y 16 bits; el alfa se descarta
+    for tipo, nombre, canales, spp in ((2, "rgb", 3, 3), (4, "grisalfa", 1, 2), (6, "rgba", 3, 4)):
+        for depth in (8, 16):
+            maxval = (1 << depth) - 1
+            muestras, filas = [], []
+            for y in range(ALTO):
+                fila = []
+                for x in range(ANCHO):
+                    for c in range(spp):
+                        v = valor(x, y, c, maxval)
+                        fila.append(v)
+                        if c < canales:
+                            muestras.append(v)
+                fmt = ">H" if depth == 16 else "B"
+                filas.append(b"".join(struct.pack(fmt, v) for v in fila))
+            agregar("%s%d" % (nombre, depth), png(tipo, depth, filas, spp * depth // 8, nivel[n % 2],
+                                                  partes=3 if tipo == 6 else 1),
+                    pnm(canales, maxval, muestras))
+            n += 1
+    return casos
+
+
+def casos_png_malos(casos):
+    bueno = casos["rgb8.png"]
+    malos = {}
+    malos["malo_corto.png"] = bueno[:len(bueno) // 2]
+    dañado = bytearray(bueno)
+    dañado[40] ^= 0x55
+    malos["malo_crc.png"] = bytes(dañado)
+
+    # Flujo zlib dañado con el CRC del bloque correcto: falla el descompresor, no el CRC
+    filas = [bytes(valor(x, y, c, 255) for x in range(ANCHO) for c in range(3)) for y in range(ALTO)]
+    comprimido = bytearray(zlib.compress(filtrar(filas, 3), 9))
+    for i in range(2, len(comprimido) - 4):
+        comprimido[i] ^= 0xa5
+    ihdr = struct.pack(">IIBBBBB", ANCHO, ALTO, 8, 2, 0, 0, 0)
+    malos["malo_zlib.png"] = (b"\x89PNG\r\n\x1a\n" + bloque(b"IHDR", ihdr) + bloque(b"IDAT", bytes(comprimido)) +
+                              bloque(b"IEND", b""))
+
+    # Índices fuera de una paleta de 2 colores
+    indices = [bytes((x + y) % 4 for x in range(ANCHO)) for y in range(ALTO)]
+    malos["malo_paleta.png"] = png(3, 8, indices, 1, 9, [0, 0, 0, 255, 255, 255])
+
+    # Sólo cabecera: 0x7fffffff x 0x7fffffff con un IDAT casi vacío; tiene que rechazarse
+    # antes de reservar nada
+    ihdr = struct.pack(">IIBBBBB", 0x7fffffff, 0x7fffffff, 8, 2, 0, 0, 0)
+    malos["malo_dimensiones.png"] = (b"\x89PNG\r\n\x1a\n" + bloque(b"IHDR", ihdr) +
+                                     bloque(b"IDAT", zlib.compress(b"\x00")) + bloque(b"IEND", b""))
+    return malos
+
+
+def qoi(pixeles, canales=4):
+    """Codificador de referencia de la especificación QOI."""
+    datos = bytearray(b"qoif" + struct.pack(">IIBB", ANCHO, ALTO, canales, 0))
+    indice = [(0, 0, 0, 0)] * 64
+    previo = (0, 0, 0, 255)
+    racha = 0
+    for i, p in enumerate(pixeles):
+        if p == previo:
+            racha += 1
+            if racha == 62 or i == len(pixeles) - 1:
+                datos.append(0xc0 | (racha - 1))
+                racha = 0
+            continue
+        if racha:
+            datos.append(0xc0 | (racha - 1))
+            racha = 0
+        r, g, b, a = p
+        h = (r * 3 + g * 5 + b * 7 + a * 11) % 64
+        if indice[h] == p:
+            datos.append(h)
+        else:
+            indice[h] = p
+            if a == previo[3]:
+                dr = (r - previo[0] + 128) % 256 - 128
+                dg = (g - previo[1] + 128) % 256 - 128
+                db = (b - previo[2] + 128) % 256 - 128
+                if -2 <= dr <= 1 and -2 <= dg <= 1 and -2 <= db <= 1:
+                    datos.append(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2))
+                elif -32 <= dg <= 31 and -8 <= dr - dg <= 7 and -8 <= db - dg <= 7:
+                    datos += bytes((0x80 | (dg + 32), (dr - dg + 8) << 4 | (db - dg + 8)))
+                else:
+                    datos += bytes((0xfe, r, g, b))
+            else:
+                datos += bytes((0xff, r, g, b, a))
+        previo = p
+    return bytes(datos + b"\x00" * 7 + b"\x01")
+
+
+def casos_qoi():
+    # Rachas, repeticiones por índice, diferencias chicas, luma, RGB completo y cambios de
+    # alfa, para pasar por todas las operaciones
+    pixeles = []
+    for y in range(ALTO):
+        for x in range(ANCHO):
+            if y == 0:
+                p = (10, 20, 30, 255)
+            elif y == 1:
+                p = (10 + x % 2, 20 - x % 2, 30, 255)
+            elif y == 2:
+                p = (50 + 5 * x, 60 + 6 * x, 70 + 4 * x, 255)
+            elif y == 3:
+                p = [(10, 20, 30, 255), (200, 100, 50, 255)][x % 2]
+            elif y == 4:
+                p = (valor(x, y, 0, 255), valor(x, y, 1, 255), valor(x, y, 2, 255), 255)
+            else:
+                p = (valor(x, y, 0, 255), x * 9, y * 17, 128 + x * 9)
+            pixeles.append(tuple(p))
+    muestras = [v for p in pixeles for v in p[:3]]
+    datos = qoi(pixeles)
+    casos = {"ops.qoi": datos, "ops.pnm": pnm(3, 255, muestras), "malo_corto.qoi": datos[:len(datos) // 2]}
+    # Sólo cabecera y marcador final con dimensiones que ningún flujo de ese tamaño cubre
+    casos["malo_grande.qoi"] = b"qoif" + struct.pack(">IIBB", 0x7fffffff, 0x7fffffff, 3, 0) + b"\x00" * 7 + b"\x01"
+
+    # Sin alfa, como escribe QoiCodec::encode: RGB y alfa siempre 255
+    opacos = [p[:3] + (255,) for p in pixeles]
+    casos["opaco.qoi"] = qoi(opacos, 3)
+    casos["opaco.pnm"] = pnm(3, 255, [v for p in opacos for v in p[:3]])
+    return casos
+
+
+def main():
+    carpeta = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    casos = casos_png()
+    casos.update(casos_png_malos(casos))
+    casos.update(casos_qoi())
+    for nombre, datos in sorted(casos.items()):
+        with open(os.path.join(carpeta, nombre), "wb") as f:
+            f.write(datos)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+# generar.py: imágenes chicas para iotests.cmake (caso equalize), con la salida que tienen
+# que dar equalize y clahe calculada acá y no con filter.cpp. Sólo usa la biblioteca
+# estándar.
+#
+#   constante.pgm      un solo valor: equalize la deja igual
+#   dos_niveles.ppm    dos valores por canal (distintos en cada canal): equalize los lleva
+#                      a 0 y maxColor -> dos_niveles_equalize.ppm
+#   clahe_gris.pgm     40x32 con maxColor 7 -> clahe_gris_clahe.pgm
+#   clahe_color.ppm    11x9 RGB -> clahe_color_clahe.ppm
+#
+# El CLAHE de referencia sigue la descripción de ClaheFilter (8x8 bloques, límite 2.0,
+# interpolación bilineal entre centros) y redondea a float32 en cada operación, igual que
+# el filtro compilado sin FILTER_NATIVE.
+#
+#   python3 generar.py [carpeta]        (por defecto la carpeta del script)
+
+import math
+import os
+import struct
+import sys
+
+
+def f32(v):
+    return struct.unpack("<f", struct.pack("<f", v))[0]
+
+
+def pnm(ancho, alto, canales, maxval, muestras):
+    cabecera = ("P6" if canales == 3 else "P5") + "\n%d %d\n%d\n" % (ancho, alto, maxval)
+    return cabecera.encode() + bytes(muestras)
+
+
+def clahe(ancho, alto, canales, maxval, muestras, bloques_x=8, bloques_y=8, limite=2.0):
+    bins = maxval + 1
+    tx = max(1, min(bloques_x, ancho))
+    ty = max(1, min(bloques_y, alto))
+
+    def muestra(x, y, c):
+        return muestras[(y * ancho + x) * canales + c]
+
+    luts = {}
+    for by in range(ty):
+        for bx in range(tx):
+            x0, x1 = bx * ancho // tx, (bx + 1) * ancho // tx
+            y0, y1 = by * alto // ty, (by + 1) * alto // ty
+            area = (x1 - x0) * (y1 - y0)
+            for c in range(canales):
+                hist = [0] * bins
+                for y in range(y0, y1):
+                    for x in range(x0, x1):
+                        hist[muestra(x, y, c)] += 1
+                tope = max(1, int(f32(f32(limite * area) / bins)))
+                exceso = sum(max(0, n - tope) for n in hist)
+                hist = [min(n, tope) + exceso // bins for n in hist]
+                resto = exceso % bins
+                if resto > 0:
+                    paso = max(1, bins // resto)
+                    v = 0
+                    while v < bins and resto > 0:
+                        hist[v] += 1
+                        v += paso
+                        resto -= 1
+                lut, acumulado = [], 0
+                for n in hist:
+                    acumulado += n
+                    lut.append((acumulado * maxval + area // 2) // area)
+                luts[(bx, by, c)] = lut
+
+    def vecinos(p, lado, n):
+        f = f32(f32(f32(p + 0.5) / lado) - 0.5)
+        i0 = math.floor(f)
+        peso = f32(f - i0)
+        i1 = i0 + 1
+        if i0 < 0:
+            i0, peso = 0, 0.0
+        i1 = min(i1, n - 1)
+        i0 = min(i0, n - 1)
+        return i0, i1, peso
+
+    lado_x, lado_y = f32(ancho / tx), f32(alto / ty)
+    salida = []
+    for y in range(alto):
+        iy0, iy1, wy = vecinos(y, lado_y, ty)
+        for x in range(ancho):
+            ix0, ix1, wx = vecinos(x, lado_x, tx)
+            for c in range(canales):
+                v = muestra(x, y, c)
+                a, b = luts[(ix0, iy0, c)][v], luts[(ix1, iy0, c)][v]
+                d, e = luts[(ix0, iy1, c)][v], luts[(ix1, iy1, c)][v]
+                arriba = f32(a + f32((b - a) * wx))
+                abajo = f32(d + f32((e - d) * wx))
+                r = int(f32(f32(arriba + f32(f32(abajo - arriba) * wy)) + 0.5))
+                salida.append(min(max(r, 0), maxval))
+    return salida
+
+
+def main():
+    carpeta = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    casos = {}
+    casos["constante.pgm"] = pnm(9, 6, 1, 255, [77] * 54)
+
+    # Cada canal con su par de valores, repartidos sin patrón regular
+    niveles = [(40, 200), (3, 250), (128, 129)]
+    entrada, esperado = [], []
+    for i in range(10 * 7):
+        for c in range(3):
+            alto = (i * 7 + c * 3) % 5 < 2
+            entrada.append(niveles[c][alto])
+            esperado.append(255 if alto else 0)
+    casos["dos_niveles.ppm"] = pnm(10, 7, 3, 255, entrada)
+    casos["dos_niveles_equalize.ppm"] = pnm(10, 7, 3, 255, esperado)
+
+    # Bloques de 5x4 con 8 cubetas: el límite (5 muestras por cubeta) recorta la zona plana
+    gris = [(x * 3 + y * 5 + x * y) % 8 if x < 27 else 2 for y in range(32) for x in range(40)]
+    casos["clahe_gris.pgm"] = pnm(40, 32, 1, 7, gris)
+    casos["clahe_gris_clahe.pgm"] = pnm(40, 32, 1, 7, clahe(40, 32, 1, 7, gris))
+
+    color = [(x * 23 + y * 41 + c * 97 + x * y * 13) % 256 for y in range(9) for x in range(11) for c in range(3)]
+    casos["clahe_color.ppm"] = pnm(11, 9, 3, 255, color)
+    casos["clahe_color_clahe.ppm"] = pnm(11, 9, 3, 255, clahe(11, 9, 3, 255, color))
+
+    for nombre, datos in sorted(casos.items()):
+        with open(os.path.join(carpeta, nombre), "wb") as f:
+            f.write(datos)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+# generar.py: contenedores .ptl dañados para iotests.cmake (caso tiled), escritos sin pasar
+# por tiled.cpp. Todos tienen que rechazarse con código 1 al leerlos entero (filter,
+# pnmtile), por región (pnmtile --region) y por cuadrantes (filter_phtreads), sin
+# reservar lo que dice la cabecera. Sólo usa la biblioteca estándar.
+#
+#   python3 generar.py [carpeta]        (por defecto la carpeta del script)
+
+import os
+import struct
+import sys
+
+
+def cabecera(magic, ancho, alto, maxval, tile_w, tile_h):
+    return b"PTL1" + magic + b"\x00\x00" + struct.pack("<IIIII", ancho, alto, maxval, tile_w, tile_h)
+
+
+def indice(desplazamientos):
+    return b"".join(struct.pack("<Q", d) for d in desplazamientos)
+
+
+def casos():
+    malos = {}
+    # Sólo cabecera: dimensiones que no entran en Image
+    malos["malo_dimensiones.ptl"] = cabecera(b"P6", 0x7fffffff, 0x7fffffff, 255, 1, 1)
+    # 65536 x 65536 teselas de 1 x 1: la cuenta en int daba 0 teselas
+    malos["malo_teselas.ptl"] = cabecera(b"P5", 65536, 65536, 255, 1, 1) + indice([36])
+    # 4096 teselas cuyo índice no entra en el archivo
+    malos["malo_indice.ptl"] = cabecera(b"P5", 4096, 1, 255, 1, 1) + bytes(72)
+
+    # Dos teselas de 2048 x 1: la primera bien, la segunda con un registro de 3 bytes que
+    # no puede dar 2048 muestras
+    datos = cabecera(b"P5", 4096, 1, 255, 2048, 1)
+    primera = b"\x00" + bytes(2048)
+    segunda = b"\x01\x81\x00"
+    inicio = len(datos) + 24
+    datos += indice([inicio, inicio + len(primera), inicio + len(primera) + len(segunda)])
+    malos["malo_tesela.ptl"] = datos + primera + segunda
+    return malos
+
+
+def main():
+    carpeta = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    for nombre, datos in sorted(casos().items()):
+        with open(os.path.join(carpeta, nombre), "wb") as f:
+            f.write(datos)
+
+
+if __name__ == "__main__":
+    main()
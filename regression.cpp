@@ -0,0 +1,274 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdlib>
+#include <cstdio>
+#include "runner.h"
+
+using namespace std;
+
+// regression: corre cada backend con cada filtro sobre la imagen de referencia, compara la
+// salida con los archivos dorados puj_<filtro>.ppm y revisa que el rendimiento no haya
+// caído respecto a una línea base guardada. Termina con código 1 si algo falla.
+//
+// Los kernels enteros (laplace, sharpen) deben coincidir exactamente. Blur usa pesos 1/9
+// en float y el resultado puede cambiar en una unidad según cómo compile el compilador la
+// suma (por ejemplo, con FMA en -march=native), así que se compara con tolerancia.
+//
+// Uso: ./regression [opciones]
+//   --serial BIN --omp BIN --pthreads BIN --mpi BIN --mpirun CMD   como en benchmark
+//   --backends serial,omp,pthreads,mpi   --filters blur,laplace,sharpen
+//   --input puj.ppm                 imagen de entrada
+//   --goldens DIR                   carpeta de puj_<filtro>.ppm (por defecto la actual)
+//   --tolerance N                   diferencia máxima permitida en kernels float (1)
+//   --workers N                     hilos o procesos para omp y mpi (3, no divide el alto)
+//   --repeat N                      muestras para la compuerta de rendimiento (3)
+//   --baseline ARCHIVO              línea base de rendimiento (regression_baseline.csv); si
+//                                   falta, o le falta un caso, la compuerta falla
+//   --allow-missing-baseline        sin línea base sólo avisa y compara las salidas
+//   --threshold F                   caída máxima permitida, 0.10 = 10 %
+//   --update-baseline               guarda los rendimientos medidos como nueva línea base
+//   --no-perf                       sólo compara las salidas
+
+struct Config {
+    Backends bins;
+    vector<string> backends = {"serial", "omp", "pthreads", "mpi"};
+    vector<string> filters = {"blur", "laplace", "sharpen"};
+    string input = "puj.ppm";
+    string goldens = ".";
+    int tolerance = 1;
+    int workers = 3;
+    int repeat = 3;
+    string baseline = "regression_baseline.csv";
+    double threshold = 0.10;
+    bool updateBaseline = false;
+    bool allowMissingBaseline = false;
+    bool perf = true;
+};
+
+struct PNM {
+    string magic;
+    int width, height, maxColor;
+    vector<int> pixels;
+};
+
+// leerPNM: carga P2/P3/P5/P6 sin depender de ninguno de los backends
+bool leerPNM(const string& path, PNM& img) {
+    ifstream in(path.c_str(), ios::binary);
+    if (!in.is_open()) return false;
+    in >> img.magic >> img.width >> img.height >> img.maxColor;
+    if (!in) return false;
+    int channels = (img.magic == "P3" || img.magic == "P6") ? 3 : 1;
+    size_t n = (size_t)img.width * img.height * channels;
+    img.pixels.resize(n);
+    if (img.magic == "P5" || img.magic == "P6") {
+        in.get();
+        int bytes = img.maxColor < 256 ? 1 : 2;
+        vector<unsigned char> raw(n * bytes);
+        in.read((char*)raw.data(), raw.size());
+        for (size_t i = 0; i < n; i++) {
+            img.pixels[i] = bytes == 1 ? raw[i] : (raw[2 * i] << 8 | raw[2 * i + 1]);
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) in >> img.pixels[i];
+    }
+    return (bool)in;
+}
+
+// comparar: diferencia máxima y cantidad de muestras distintas; false si no son comparables
+bool comparar(const PNM& a, const PNM& b, int& maxDiff, long long& distintas) {
+    if (a.width != b.width || a.height != b.height || a.maxColor != b.maxColor ||
+        a.pixels.size() != b.pixels.size()) {
+        return false;
+    }
+    maxDiff = 0;
+    distintas = 0;
+    for (size_t i = 0; i < a.pixels.size(); i++) {
+        int d = abs(a.pixels[i] - b.pixels[i]);
+        if (d > 0) distintas++;
+        if (d > maxDiff) maxDiff = d;
+    }
+    return true;
+}
+
+bool kernelFlotante(const string& filter) {
+    return filter == "blur";
+}
+
+map<string, double> leerLineaBase(const string& path) {
+    map<string, double> base;
+    ifstream in(path.c_str());
+    string linea;
+    while (getline(in, linea)) {
+        vector<string> campos = separar(linea, ',');
+        if (campos.size() != 3 || campos[0] == "backend") continue;
+        base[campos[0] + "/" + campos[1]] = atof(campos[2].c_str());
+    }
+    return base;
+}
+
+bool leerArgumentos(int argc, char* argv[], Config& cfg) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--update-baseline") {
+            cfg.updateBaseline = true;
+            continue;
+        }
+        if (arg == "--allow-missing-baseline") {
+            cfg.allowMissingBaseline = true;
+            continue;
+        }
+        if (arg == "--no-perf") {
+            cfg.perf = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Falta el valor de " << arg << "\n";
+            return false;
+        }
+        string valor = argv[++i];
+        if (cfg.bins.leerOpcion(arg, valor)) continue;
+        if (arg == "--backends") cfg.backends = separar(valor, ',');
+        else if (arg == "--filters") cfg.filters = separar(valor, ',');
+        else if (arg == "--input") cfg.input = valor;
+        else if (arg == "--goldens") cfg.goldens = valor;
+        else if (arg == "--tolerance") cfg.tolerance = max(0, atoi(valor.c_str()));
+        else if (arg == "--workers") cfg.workers = max(1, atoi(valor.c_str()));
+        else if (arg == "--repeat") cfg.repeat = max(1, atoi(valor.c_str()));
+        else if (arg == "--baseline") cfg.baseline = valor;
+        else if (arg == "--threshold") cfg.threshold = atof(valor.c_str());
+        else {
+            cerr << "Opción desconocida: " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Config cfg;
+    if (!leerArgumentos(argc, argv, cfg)) return 1;
+
+    string entrada = rutaAbsoluta(cfg.input);
+    PNM original;
+    if (entrada.empty() || !leerPNM(entrada, original)) {
+        cerr << "No se pudo leer la entrada: " << cfg.input << "\n";
+        return 1;
+    }
+    int channels = (original.magic == "P3" || original.magic == "P6") ? 3 : 1;
+
+    string dir = crearDirectorioTemporal("regression");
+    if (dir.empty()) {
+        cerr << "No se pudo crear el directorio temporal\n";
+        return 1;
+    }
+    vector<string> backends = resolverBackends(cfg.bins, cfg.backends);
+    if (backends.size() != cfg.backends.size()) {
+        cerr << "Faltan backends: la regresión debe cubrirlos todos\n";
+        return 1;
+    }
+
+    map<string, double> base = leerLineaBase(cfg.baseline);
+    bool gate = cfg.perf && !cfg.updateBaseline;
+    if (gate && base.empty()) {
+        if (!cfg.allowMissingBaseline) {
+            cerr << "Sin línea base en " << cfg.baseline << " (generarla con --update-baseline)\n";
+            system(("rm -rf '" + dir + "'").c_str());
+            return 1;
+        }
+        cout << "Sin línea base en " << cfg.baseline << ": se omite la compuerta de rendimiento\n";
+        gate = false;
+    }
+
+    ostringstream nuevaBase;
+    nuevaBase << "backend,filter,mpixels_per_s\n";
+    int fallas = 0;
+    double megapixeles = (double)original.width * original.height / 1e6;
+
+    printf("%-9s %-8s %-10s %8s %12s %10s %10s  %s\n", "backend", "filter", "salida", "max dif",
+           "distintas", "MPix/s", "base", "resultado");
+    for (const string& filter : cfg.filters) {
+        PNM golden;
+        string goldenPath = cfg.goldens + "/puj_" + filter + ".ppm";
+        if (!leerPNM(goldenPath, golden)) {
+            cerr << "No se encontró el archivo dorado " << goldenPath << "\n";
+            fallas++;
+            continue;
+        }
+
+        for (const string& backend : backends) {
+            int workers = (backend == "omp" || backend == "mpi") ? cfg.workers : 1;
+            bool ok = true;
+            string motivo;
+
+            // Salida: la primera corrida se compara con el archivo dorado
+            Corrida corrida;
+            PNM salida;
+            int maxDiff = -1;
+            long long distintas = -1;
+            if (!ejecutarBackend(cfg.bins, dir, backend, filter, entrada, channels, workers, corrida) ||
+                !leerPNM(corrida.salida, salida)) {
+                ok = false;
+                motivo = "no se ejecutó";
+            } else if (!comparar(salida, golden, maxDiff, distintas)) {
+                ok = false;
+                motivo = "dimensiones distintas";
+            } else {
+                int permitido = kernelFlotante(filter) ? cfg.tolerance : 0;
+                if (maxDiff > permitido) {
+                    ok = false;
+                    motivo = "salida distinta";
+                }
+            }
+
+            // Rendimiento: mediana del cómputo en cfg.repeat corridas más
+            double mpix = 0.0, referencia = 0.0;
+            if (ok && cfg.perf) {
+                vector<long long> muestras;
+                muestras.push_back(corrida.computeNs);
+                for (int i = 1; i < cfg.repeat && ok; i++) {
+                    Corrida extra;
+                    ok = ejecutarBackend(cfg.bins, dir, backend, filter, entrada, channels, workers, extra);
+                    muestras.push_back(extra.computeNs);
+                }
+                double med = percentil(muestras, 50);
+                mpix = med > 0 ? megapixeles / (med / 1e9) : 0.0;
+                nuevaBase << backend << "," << filter << "," << mpix << "\n";
+
+                map<string, double>::iterator it = base.find(backend + "/" + filter);
+                if (gate && it == base.end()) {
+                    ok = cfg.allowMissingBaseline;
+                    if (!ok) motivo = "sin línea base para el caso";
+                } else if (gate) {
+                    referencia = it->second;
+                    if (mpix < referencia * (1.0 - cfg.threshold)) {
+                        ok = false;
+                        motivo = "rendimiento bajo la línea base";
+                    }
+                }
+            }
+
+            if (!ok) fallas++;
+            printf("%-9s %-8s %-10s %8d %12lld %10.2f %10.2f  %s\n", backend.c_str(), filter.c_str(),
+                   maxDiff == 0 ? "exacta" : (maxDiff > 0 ? "tolerada" : "-"), maxDiff, distintas, mpix,
+                   referencia, ok ? "OK" : ("FALLA: " + motivo).c_str());
+        }
+    }
+
+    if (cfg.updateBaseline) {
+        ofstream out(cfg.baseline.c_str());
+        out << nuevaBase.str();
+        cout << "Línea base guardada en " << cfg.baseline << "\n";
+    }
+
+    system(("rm -rf '" + dir + "'").c_str());
+    if (fallas > 0) {
+        cout << fallas << " caso(s) fallaron\n";
+        return 1;
+    }
+    cout << "Todos los casos pasaron\n";
+    return 0;
+}
@@ -0,0 +1,173 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+// runner.h: ejecución de los cuatro backends como procesos aparte, compartida por el
+// benchmark y la suite de regresión. Los tiempos se leen del JSON que escribe timing.h.
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Backends: ejecutables de cada backend y el lanzador de MPI
+struct Backends {
+    std::string serialBin = "./filter";
+    std::string ompBin = "./filter_omp";
+    std::string pthreadsBin = "./filter_phtreads";
+    std::string mpiBin = "./filter_MPI";
+    std::string mpirun = "mpirun";
+
+    std::string* binario(const std::string& backend) {
+        if (backend == "serial") return &serialBin;
+        if (backend == "omp") return &ompBin;
+        if (backend == "pthreads") return &pthreadsBin;
+        if (backend == "mpi") return &mpiBin;
+        return NULL;
+    }
+
+    // leerOpcion: consume --serial/--omp/--pthreads/--mpi/--mpirun; false si no es una de ellas
+    bool leerOpcion(const std::string& arg, const std::string& valor) {
+        if (arg == "--mpirun") {
+            mpirun = valor;
+            return true;
+        }
+        if (arg.size() < 3 || arg.compare(0, 2, "--") != 0) return false;
+        std::string* bin = binario(arg.substr(2));
+        if (bin == NULL) return false;
+        *bin = valor;
+        return true;
+    }
+};
+
+inline std::vector<std::string> separar(const std::string& texto, char sep) {
+    std::vector<std::string> partes;
+    std::stringstream in(texto);
+    std::string parte;
+    while (std::getline(in, parte, sep)) if (!parte.empty()) partes.push_back(parte);
+    return partes;
+}
+
+inline std::string rutaAbsoluta(const std::string& path) {
+    char* real = realpath(path.c_str(), NULL);
+    if (real == NULL) return "";
+    std::string r = real;
+    free(real);
+    return r;
+}
+
+// resolverBackends: deja sólo los backends cuyo ejecutable existe, con rutas absolutas
+// porque los backends corren dentro de un directorio temporal
+inline std::vector<std::string> resolverBackends(Backends& bins, const std::vector<std::string>& pedidos) {
+    std::vector<std::string> backends;
+    for (size_t i = 0; i < pedidos.size(); i++) {
+        const std::string& b = pedidos[i];
+        std::string* bin = bins.binario(b);
+        if (bin == NULL) {
+            std::cerr << "Backend desconocido: " << b << "\n";
+            continue;
+        }
+        std::string real = rutaAbsoluta(*bin);
+        if (real.empty() || access(real.c_str(), X_OK) != 0) {
+            std::cerr << "Backend omitido (no se encontró " << *bin << "): " << b << "\n";
+            continue;
+        }
+        *bin = real;
+        backends.push_back(b);
+    }
+    return backends;
+}
+
+// extraerEntero: valor numérico de "clave": en una línea JSON de timing.h; en una serie
+// (addExtra) devuelve el primer elemento
+inline long long extraerEntero(const std::string& linea, const std::string& clave) {
+    size_t pos = linea.find("\"" + clave + "\":");
+    if (pos == std::string::npos) return -1;
+    pos += clave.size() + 3;
+    if (pos < linea.size() && linea[pos] == '[') pos++;
+    return atoll(linea.c_str() + pos);
+}
+
+inline std::string extraerTexto(const std::string& linea, const std::string& clave) {
+    size_t pos = linea.find("\"" + clave + "\":\"");
+    if (pos == std::string::npos) return "";
+    pos += clave.size() + 4;
+    return linea.substr(pos, linea.find('"', pos) - pos);
+}
+
+// Corrida: tiempos de una ejecución y el archivo que produjo
+struct Corrida {
+    long long computeNs = -1;
+    long long wallNs = -1;
+    int reportedWorkers = 0;
+    long long regionNs = -1;   // filter_omp: la región paralela de los tres filtros
+    std::string salida;
+};
+
+// ejecutarBackend: corre una vez el backend dentro de dir. filter_omp siempre aplica los
+// tres filtros y escribe out_<filtro>.ppm, así que de él se toma el registro y el archivo
+// del filtro pedido. "stream" es el ejecutable serial en modo --stream (por bandas, con la
+// E/S de FILTER_STREAM_IO). entorno son asignaciones VAR=valor extra para el proceso.
+inline bool ejecutarBackend(const Backends& bins, const std::string& dir, const std::string& backend,
+                            const std::string& filter, const std::string& entrada, int channels,
+                            int workers, Corrida& corrida, const std::string& entorno = "") {
+    std::string jsonFile = dir + "/timing.jsonl";
+    unlink(jsonFile.c_str());
+    corrida.salida = dir + (channels == 3 ? "/out.ppm" : "/out.pgm");
+
+    std::ostringstream cmd;
+    cmd << "cd '" << dir << "' && FILTER_TIMING_JSON='" << jsonFile << "' ";
+    if (!entorno.empty()) cmd << entorno << " ";
+    if (backend == "serial") {
+        cmd << "'" << bins.serialBin << "' '" << entrada << "' '" << corrida.salida << "' " << filter;
+    } else if (backend == "stream") {
+        cmd << "'" << bins.serialBin << "' --stream '" << entrada << "' '" << corrida.salida << "' " << filter;
+    } else if (backend == "omp") {
+        cmd << "OMP_NUM_THREADS=" << workers << " '" << bins.ompBin << "' '" << entrada << "'";
+        corrida.salida = dir + "/out_" + filter + ".ppm";
+    } else if (backend == "pthreads") {
+        cmd << "'" << bins.pthreadsBin << "' '" << entrada << "' '" << corrida.salida << "' " << filter;
+    } else {
+        cmd << bins.mpirun << " -np " << workers << " '" << bins.mpiBin << "' '" << entrada
+            << "' '" << corrida.salida << "' " << filter;
+    }
+    cmd << " > /dev/null 2>&1";
+
+    if (system(cmd.str().c_str()) != 0) return false;
+
+    std::ifstream in(jsonFile.c_str());
+    std::string linea;
+    while (std::getline(in, linea)) {
+        if (extraerTexto(linea, "filter") != filter) continue;
+        corrida.computeNs = extraerEntero(linea, "compute");
+        corrida.wallNs = extraerEntero(linea, "wall_ns");
+        corrida.reportedWorkers = (int)extraerEntero(linea, "workers");
+        corrida.regionNs = extraerEntero(linea, "region_ns");
+        return corrida.computeNs >= 0;
+    }
+    return false;
+}
+
+// percentil: interpolación lineal sobre las muestras ordenadas
+inline double percentil(std::vector<long long> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    double pos = p / 100.0 * (v.size() - 1);
+    size_t i = (size_t)pos;
+    if (i + 1 >= v.size()) return (double)v.back();
+    return v[i] + (pos - i) * (v[i + 1] - v[i]);
+}
+
+// crearDirectorioTemporal: directorio de trabajo para las salidas de los backends
+inline std::string crearDirectorioTemporal(const char* prefijo) {
+    std::string plantilla = std::string("/tmp/") + prefijo + "XXXXXX";
+    std::vector<char> buffer(plantilla.begin(), plantilla.end());
+    buffer.push_back('\0');
+    if (mkdtemp(buffer.data()) == NULL) return "";
+    return std::string(buffer.data());
+}
+
+#endif
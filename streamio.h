@@ -0,0 +1,366 @@
+#ifndef STREAMIO_H
+#define STREAMIO_H
+
+// streamio.h: lectura y escritura secuencial de archivos grandes para el modo --stream de
+// filter, que recorre la imagen por bandas sin cargarla entera. Tres modos
+// (FILTER_STREAM_IO):
+//   buffered   read/write comunes; el núcleo hace la lectura anticipada con la caché de
+//              páginas (por defecto)
+//   mmap       el archivo proyectado en memoria, madvise(MADV_SEQUENTIAL)
+//   direct     O_DIRECT: no pasa por la caché de páginas, así procesar un archivo de
+//              decenas de GB no desaloja los datos de los demás servicios del host. Un
+//              hilo de E/S lee por adelantado (o escribe por detrás) en bloques de 4 MB
+//              alineados a 4 KB, con una cola de BLOQUES bloques entre él y el filtro
+// Si el sistema de archivos no acepta O_DIRECT (tmpfs, por ejemplo) se usa buffered.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "memory.h"
+
+enum StreamMode { STREAM_BUFFERED, STREAM_MMAP, STREAM_DIRECT };
+
+inline const char* streamModeName(StreamMode m) {
+    static const char* names[] = {"buffered", "mmap", "direct"};
+    return names[m];
+}
+
+// streamModeFromEnv: FILTER_STREAM_IO; false si el valor no es uno de los tres modos
+inline bool streamModeFromEnv(StreamMode& modo) {
+    const char* env = std::getenv("FILTER_STREAM_IO");
+    std::string v = env ? env : "";
+    if (v.empty() || v == "buffered") modo = STREAM_BUFFERED;
+    else if (v == "mmap") modo = STREAM_MMAP;
+    else if (v == "direct") modo = STREAM_DIRECT;
+    else return false;
+    return true;
+}
+
+// ColaBloques: anillo de bloques alineados entre el hilo que filtra y el hilo de E/S.
+// Cada bloque está libre (lo puede llenar el productor) o lleno (lo puede vaciar el
+// consumidor); en lectura produce el hilo de E/S y en escritura el filtro.
+class ColaBloques {
+public:
+    static const size_t ALINEACION = 4096;
+    static const size_t TAM_BLOQUE = 4 << 20;
+    static const int BLOQUES = 4;
+
+    struct Bloque {
+        char* datos;
+        size_t len;
+        bool lleno;
+        bool ultimo;   // no vienen más bloques después de este
+    };
+
+    ColaBloques() : cerrada(false) {
+        for (int i = 0; i < BLOQUES; i++) {
+            void* p = NULL;
+            if (posix_memalign(&p, ALINEACION, TAM_BLOQUE) != 0) throw std::bad_alloc();
+            Bloque b = {(char*)p, 0, false, false};
+            bloques.push_back(b);
+        }
+        MemoryStats::instance().add(MEM_FILE, (long long)BLOQUES * TAM_BLOQUE);
+    }
+    ~ColaBloques() {
+        for (size_t i = 0; i < bloques.size(); i++) free(bloques[i].datos);
+    }
+
+    // esperarLibre / esperarLleno: bloquean hasta que el bloque i tenga ese estado; false si
+    // la otra punta cerró la cola
+    bool esperarLibre(int i) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cambio.wait(lock, [&] { return !bloques[i].lleno || cerrada; });
+        return !bloques[i].lleno;
+    }
+    bool esperarLleno(int i) {
+        std::unique_lock<std::mutex> lock(mtx);
+        cambio.wait(lock, [&] { return bloques[i].lleno || cerrada; });
+        return bloques[i].lleno;
+    }
+    void marcar(int i, bool lleno) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            bloques[i].lleno = lleno;
+        }
+        cambio.notify_all();
+    }
+    void cerrar() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            cerrada = true;
+        }
+        cambio.notify_all();
+    }
+
+    Bloque& operator[](int i) { return bloques[i]; }
+
+private:
+    std::vector<Bloque> bloques;
+    std::mutex mtx;
+    std::condition_variable cambio;
+    bool cerrada;
+};
+
+// LectorSecuencial: entrega el archivo en orden, de a pedazos de cualquier tamaño
+class LectorSecuencial {
+    StreamMode modo;
+    int fd;
+    const char* mapa;
+    size_t tamMapa, pos;
+    ColaBloques* cola;
+    std::thread hilo;
+    int actual;
+    size_t enBloque;
+    std::atomic<bool> error;   // lo pone el hilo de E/S y lo lee leer()
+
+    // leerAdelantado: hilo de E/S del modo direct, llena los bloques en orden
+    void leerAdelantado() {
+        off_t offset = 0;
+        for (int i = 0;; i = (i + 1) % ColaBloques::BLOQUES) {
+            if (!cola->esperarLibre(i)) return;
+            ColaBloques::Bloque& b = (*cola)[i];
+            size_t total = 0;
+            ssize_t n = 0;
+            while (total < ColaBloques::TAM_BLOQUE) {
+                n = pread(fd, b.datos + total, ColaBloques::TAM_BLOQUE - total, offset + total);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break;
+                total += n;
+                // Con O_DIRECT una lectura corta sólo puede ser el final del archivo
+                if (total % ColaBloques::ALINEACION != 0) break;
+            }
+            b.len = total;
+            b.ultimo = n <= 0 || total < ColaBloques::TAM_BLOQUE;
+            if (n < 0) error = true;
+            offset += total;
+            cola->marcar(i, true);
+            if (b.ultimo) return;
+        }
+    }
+
+public:
+    LectorSecuencial() : modo(STREAM_BUFFERED), fd(-1), mapa(NULL), tamMapa(0), pos(0), cola(NULL),
+                         actual(0), enBloque(0), error(false) {}
+    ~LectorSecuencial() { cerrar(); }
+
+    // abrir: en modo direct cae a buffered si el sistema de archivos no acepta O_DIRECT
+    bool abrir(const std::string& path, StreamMode m) {
+        modo = m;
+        if (modo == STREAM_DIRECT) {
+            fd = open(path.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+            if (fd < 0 && errno == EINVAL) modo = STREAM_BUFFERED;
+            else if (fd < 0) return false;
+        }
+        if (fd < 0) fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        if (modo == STREAM_MMAP) {
+            struct stat st;
+            if (fstat(fd, &st) != 0) return false;
+            tamMapa = (size_t)st.st_size;
+            if (tamMapa > 0) {
+                void* p = mmap(NULL, tamMapa, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) return false;
+                mapa = (const char*)p;
+                madvise(p, tamMapa, MADV_SEQUENTIAL);
+            }
+        } else if (modo == STREAM_BUFFERED) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        } else {
+            cola = new ColaBloques();
+            hilo = std::thread(&LectorSecuencial::leerAdelantado, this);
+        }
+        return true;
+    }
+
+    StreamMode modoReal() const { return modo; }
+
+    // leer: exactamente n bytes; false si el archivo termina antes o hubo un error
+    bool leer(void* destino, size_t n) {
+        char* dst = (char*)destino;
+        if (modo == STREAM_MMAP) {
+            if (tamMapa - pos < n) return false;
+            memcpy(dst, mapa + pos, n);
+            pos += n;
+            return true;
+        }
+        if (modo == STREAM_BUFFERED) {
+            while (n > 0) {
+                ssize_t r = read(fd, dst, n);
+                if (r < 0 && errno == EINTR) continue;
+                if (r <= 0) return false;
+                dst += r;
+                n -= r;
+            }
+            return true;
+        }
+        while (n > 0) {
+            if (!cola->esperarLleno(actual)) return false;
+            ColaBloques::Bloque& b = (*cola)[actual];
+            size_t k = std::min(n, b.len - enBloque);
+            memcpy(dst, b.datos + enBloque, k);
+            dst += k;
+            n -= k;
+            enBloque += k;
+            if (enBloque == b.len) {
+                if (b.ultimo) return n == 0 && !error;
+                cola->marcar(actual, false);
+                actual = (actual + 1) % ColaBloques::BLOQUES;
+                enBloque = 0;
+            }
+        }
+        return true;
+    }
+
+    void cerrar() {
+        if (cola) {
+            cola->cerrar();
+            if (hilo.joinable()) hilo.join();
+            delete cola;
+            cola = NULL;
+        }
+        if (mapa) munmap((void*)mapa, tamMapa);
+        mapa = NULL;
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+};
+
+// EscritorSecuencial: escribe el archivo en orden; el tamaño total se conoce de antemano
+// (el modo mmap lo necesita para proyectar el archivo)
+class EscritorSecuencial {
+    StreamMode modo;
+    int fd;
+    char* mapa;
+    size_t total, pos;
+    ColaBloques* cola;
+    std::thread hilo;
+    int actual;
+    std::atomic<bool> error;   // lo pone el hilo de E/S y lo leen entregar() y cerrar()
+
+    // escribirDetras: hilo de E/S del modo direct, vacía los bloques en orden. El último
+    // se rellena hasta la alineación y cerrar() recorta el archivo a su tamaño
+    void escribirDetras() {
+        off_t offset = 0;
+        for (int i = 0;; i = (i + 1) % ColaBloques::BLOQUES) {
+            if (!cola->esperarLleno(i)) return;
+            ColaBloques::Bloque& b = (*cola)[i];
+            size_t len = (b.len + ColaBloques::ALINEACION - 1) & ~(ColaBloques::ALINEACION - 1);
+            memset(b.datos + b.len, 0, len - b.len);
+            size_t hecho = 0;
+            while (hecho < len) {
+                ssize_t n = pwrite(fd, b.datos + hecho, len - hecho, offset + hecho);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    error = true;
+                    break;
+                }
+                hecho += n;
+            }
+            offset += b.len;
+            bool ultimo = b.ultimo;
+            b.len = 0;
+            cola->marcar(i, false);
+            if (error) cola->cerrar();   // el filtro deja de esperar bloques libres
+            if (ultimo || error) return;
+        }
+    }
+
+    bool entregar(bool ultimo) {
+        (*cola)[actual].ultimo = ultimo;
+        cola->marcar(actual, true);
+        actual = (actual + 1) % ColaBloques::BLOQUES;
+        if (!ultimo && !cola->esperarLibre(actual)) return false;
+        return !error;
+    }
+
+public:
+    EscritorSecuencial() : modo(STREAM_BUFFERED), fd(-1), mapa(NULL), total(0), pos(0), cola(NULL),
+                           actual(0), error(false) {}
+    ~EscritorSecuencial() { cerrar(); }
+
+    bool abrir(const std::string& path, StreamMode m, size_t tamTotal) {
+        modo = m;
+        total = tamTotal;
+        int flags = O_CREAT | O_TRUNC | O_CLOEXEC | (modo == STREAM_MMAP ? O_RDWR : O_WRONLY);
+        if (modo == STREAM_DIRECT) {
+            fd = open(path.c_str(), flags | O_DIRECT, 0644);
+            if (fd < 0 && errno == EINVAL) modo = STREAM_BUFFERED;
+            else if (fd < 0) return false;
+        }
+        if (fd < 0) fd = open(path.c_str(), flags, 0644);
+        if (fd < 0) return false;
+        if (modo == STREAM_MMAP && total > 0) {
+            if (ftruncate(fd, total) != 0) return false;
+            void* p = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) return false;
+            mapa = (char*)p;
+            madvise(p, total, MADV_SEQUENTIAL);
+        } else if (modo == STREAM_DIRECT) {
+            cola = new ColaBloques();
+            hilo = std::thread(&EscritorSecuencial::escribirDetras, this);
+        }
+        return true;
+    }
+
+    bool escribir(const void* origen, size_t n) {
+        const char* src = (const char*)origen;
+        if (modo == STREAM_MMAP) {
+            if (total - pos < n) return false;
+            memcpy(mapa + pos, src, n);
+            pos += n;
+            return true;
+        }
+        if (modo == STREAM_BUFFERED) {
+            while (n > 0) {
+                ssize_t w = write(fd, src, n);
+                if (w < 0 && errno == EINTR) continue;
+                if (w <= 0) return false;
+                src += w;
+                n -= w;
+            }
+            return true;
+        }
+        while (n > 0) {
+            ColaBloques::Bloque& b = (*cola)[actual];
+            size_t k = std::min(n, ColaBloques::TAM_BLOQUE - b.len);
+            memcpy(b.datos + b.len, src, k);
+            b.len += k;
+            src += k;
+            n -= k;
+            if (b.len == ColaBloques::TAM_BLOQUE && !entregar(false)) return false;
+        }
+        return true;
+    }
+
+    // cerrar: termina las escrituras pendientes; false si alguna falló
+    bool cerrar() {
+        bool ok = !error;
+        if (cola) {
+            ok = entregar(true) && ok;
+            if (hilo.joinable()) hilo.join();
+            ok = ok && !error;
+            delete cola;
+            cola = NULL;
+            if (fd >= 0 && ftruncate(fd, total) != 0) ok = false;
+        }
+        if (mapa) munmap(mapa, total);
+        mapa = NULL;
+        if (fd >= 0 && close(fd) != 0) ok = false;
+        fd = -1;
+        return ok;
+    }
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+// synthetic.h: generador de imágenes PNM de prueba (ruido, degradados, tablero de ajedrez)
+// de cualquier tamaño, con 1 o 3 canales, maxColor hasta 65535, en ASCII (P2/P3) o
+// binario (P5/P6). Cada muestra depende sólo de su posición y de la semilla, así que el
+// resultado es idéntico sin importar cuántos hilos lo escriban.
+
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct SyntheticSpec {
+    long long width = 1920;
+    long long height = 600;
+    int channels = 3;
+    int maxColor = 255;
+    bool binary = false;
+    std::string pattern = "noise";   // noise, gradient, checker
+    int cell = 64;                   // lado de cada casilla del tablero
+    unsigned long long seed = 42;
+    int threads = 0;                 // 0: hardware_concurrency
+};
+
+// mix64: hash splitmix64, da ruido reproducible a partir del índice de la muestra
+inline unsigned long long mix64(unsigned long long z) {
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+enum PatternKind { PATTERN_NOISE, PATTERN_GRADIENT, PATTERN_CHECKER, PATTERN_UNKNOWN };
+
+inline PatternKind patternKind(const std::string& name) {
+    if (name == "noise") return PATTERN_NOISE;
+    if (name == "gradient") return PATTERN_GRADIENT;
+    if (name == "checker") return PATTERN_CHECKER;
+    return PATTERN_UNKNOWN;
+}
+
+// sampleAt: valor de la muestra (x, y, c); kind es patternKind(s.pattern), calculado una
+// sola vez por banda para no comparar cadenas en cada muestra
+inline int sampleAt(const SyntheticSpec& s, PatternKind kind, long long x, long long y, int c) {
+    if (kind == PATTERN_GRADIENT) {
+        // Gris: diagonal. Color: rojo horizontal, verde vertical, azul diagonal inverso
+        long long w = std::max(1LL, s.width - 1), h = std::max(1LL, s.height - 1);
+        if (s.channels == 1 || c == 2) {
+            long long t = (c == 2) ? (w - x) + (h - y) : x + y;
+            return (int)(t * s.maxColor / (w + h));
+        }
+        return (int)((c == 0 ? x * s.maxColor / w : y * s.maxColor / h));
+    }
+    if (kind == PATTERN_CHECKER) {
+        bool on = ((x / s.cell + y / s.cell) & 1) != 0;
+        return on ? s.maxColor : 0;
+    }
+    unsigned long long idx = ((unsigned long long)y * s.width + x) * s.channels + c;
+    return (int)(mix64(idx ^ (s.seed << 1)) % (unsigned long long)(s.maxColor + 1));
+}
+
+// formatRows: escribe las filas [y0, y1) en out con el formato de salida
+inline void formatRows(const SyntheticSpec& s, long long y0, long long y1, std::string& out) {
+    out.clear();
+    PatternKind kind = patternKind(s.pattern);
+    int bytesPerSample = (s.maxColor < 256) ? 1 : 2;
+    if (s.binary) out.reserve((size_t)((y1 - y0) * s.width * s.channels * bytesPerSample));
+    char num[8];
+    for (long long y = y0; y < y1; y++) {
+        for (long long x = 0; x < s.width; x++) {
+            for (int c = 0; c < s.channels; c++) {
+                int v = sampleAt(s, kind, x, y, c);
+                if (s.binary) {
+                    if (bytesPerSample == 2) out += (char)(v >> 8);
+                    out += (char)(v & 255);
+                } else {
+                    // Conversión a decimal a mano: to_string por muestra domina el tiempo
+                    int n = 0;
+                    do { num[n++] = (char)('0' + v % 10); v /= 10; } while (v > 0);
+                    while (n > 0) out += num[--n];
+                    out += '\n';
+                }
+            }
+        }
+    }
+}
+
+// writeSynthetic: genera el archivo por lotes de bandas de filas. Cada hilo formatea su
+// banda en paralelo y después las bandas se escriben en orden, porque en ASCII el tamaño
+// de cada banda no se conoce antes de formatearla.
+inline bool writeSynthetic(const std::string& path, const SyntheticSpec& s) {
+    if (s.width <= 0 || s.height <= 0 || (s.channels != 1 && s.channels != 3) ||
+        s.maxColor < 1 || s.maxColor > 65535 || s.cell < 1 || patternKind(s.pattern) == PATTERN_UNKNOWN) {
+        return false;
+    }
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    std::string magic = s.channels == 3 ? (s.binary ? "P6" : "P3") : (s.binary ? "P5" : "P2");
+    std::string header = magic + "\n" + std::to_string(s.width) + " " + std::to_string(s.height) + "\n" +
+                         std::to_string(s.maxColor) + "\n";
+    bool ok = write(fd, header.data(), header.size()) == (ssize_t)header.size();
+
+    int threads = s.threads > 0 ? s.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    // Bandas de unos 4 MB de muestras para acotar la memoria con imágenes de gigapíxeles
+    long long rowsPerBand = std::max(1LL, (4LL << 20) / (s.width * s.channels));
+    std::vector<std::string> buffers(threads);
+
+    for (long long y = 0; y < s.height && ok; y += rowsPerBand * threads) {
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; t++) {
+            long long y0 = std::min(s.height, y + t * rowsPerBand);
+            long long y1 = std::min(s.height, y0 + rowsPerBand);
+            pool.push_back(std::thread([&s, &buffers, t, y0, y1]() { formatRows(s, y0, y1, buffers[t]); }));
+        }
+        for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+        for (int t = 0; t < threads && ok; t++) {
+            const char* p = buffers[t].data();
+            size_t left = buffers[t].size();
+            while (left > 0) {
+                ssize_t n = write(fd, p, left);
+                if (n <= 0) {
+                    ok = false;
+                    break;
+                }
+                p += n;
+                left -= (size_t)n;
+            }
+        }
+    }
+    return close(fd) == 0 && ok;
+}
+
+// parseSize: ANCHOxALTO o los nombres 8k, 16k y gigapixel
+inline bool parseSize(const std::string& text, long long& width, long long& height) {
+    if (text == "8k") { width = 7680; height = 4320; return true; }
+    if (text == "16k") { width = 15360; height = 8640; return true; }
+    if (text == "gigapixel") { width = 32768; height = 32768; return true; }
+    return std::sscanf(text.c_str(), "%lldx%lld", &width, &height) == 2 && width > 0 && height > 0;
+}
+
+#endif
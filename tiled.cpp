@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include "tiled.h"
+
+using namespace std;
+
+// hilosTeselas: FILTER_TILE_THREADS o los hilos del procesador, nunca más que teselas
+static int hilosTeselas(size_t teselas) {
+    const char* env = getenv("FILTER_TILE_THREADS");
+    int n = (env && atoi(env) > 0) ? atoi(env) : (int)thread::hardware_concurrency();
+    return (int)max((size_t)1, min((size_t)n, teselas));
+}
+
+// paraCada: f(i) para i en [0, n), repartido entre hilos que toman el siguiente índice libre
+template <class F>
+static void paraCada(size_t n, F f) {
+    int hilos = hilosTeselas(n);
+    if (hilos == 1) {
+        for (size_t i = 0; i < n; i++) f(i);
+        return;
+    }
+    atomic<size_t> siguiente(0);
+    vector<thread> grupo;
+    for (int t = 0; t < hilos; t++) {
+        grupo.push_back(thread([&]() {
+            for (size_t i = siguiente++; i < n; i = siguiente++) f(i);
+        }));
+    }
+    for (size_t t = 0; t < grupo.size(); t++) grupo[t].join();
+}
+
+static void ponerU(unsigned char* p, unsigned long long v, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static unsigned long long leerU(const unsigned char* p, int bytes) {
+    unsigned long long v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+// leerCabecera: los 28 bytes fijos; false si no es un .ptl válido, si la cabecera con el
+// índice no entra en tamArchivo bytes o si las teselas no pueden dar tantas muestras
+// (PackBits saca a lo sumo 64 bytes por byte de entrada). Las dimensiones tienen que
+// caber en Image, así ninguna cuenta de filas, teselas o desplazamientos desborda
+static bool leerCabecera(const unsigned char* p, size_t n, size_t tamArchivo, TileContainer::Header& h) {
+    if (n < 28 || memcmp(p, "PTL1", 4) != 0) return false;
+    h.magic = string((const char*)p + 4, 2);
+    h.width = (int)leerU(p + 8, 4);
+    h.height = (int)leerU(p + 12, 4);
+    h.maxColor = (int)leerU(p + 16, 4);
+    h.tileW = (int)leerU(p + 20, 4);
+    h.tileH = (int)leerU(p + 24, 4);
+    bool tipo = h.magic == "P2" || h.magic == "P3" || h.magic == "P5" || h.magic == "P6";
+    if (!tipo || h.width <= 0 || h.height <= 0 || h.maxColor <= 0 || h.maxColor >= 65536 || h.tileW <= 0 ||
+        h.tileH <= 0 || !Image::sizeFits(h.magic, h.width, h.height)) {
+        return false;
+    }
+    int bps = h.maxColor < 256 ? 1 : 2;
+    if ((unsigned long long)h.width * h.height * h.channels() / 64 > tamArchivo / bps) return false;
+    return (size_t)h.tilesX() <= (tamArchivo / 8) / (size_t)h.tilesY() && h.bytes() <= tamArchivo;
+}
+
+// leerIndice: desplazamientos de las teselas, crecientes y dentro de tamArchivo
+static bool leerIndice(const unsigned char* p, const TileContainer::Header& h, size_t tamArchivo,
+                       vector<unsigned long long>& index) {
+    if (h.bytes() > tamArchivo) return false;
+    index.resize(h.tiles() + 1);
+    for (size_t i = 0; i < index.size(); i++) {
+        index[i] = leerU(p + 8 * i, 8);
+        if (index[i] < h.bytes() || index[i] > tamArchivo || (i > 0 && index[i] < index[i - 1])) return false;
+    }
+    return true;
+}
+
+// packBits: rachas de 3 a 128 bytes iguales como (257 - n, byte) y el resto en literales
+// de hasta 128 bytes precedidos por n - 1
+static void packBits(const unsigned char* in, size_t n, string& out) {
+    size_t i = 0;
+    while (i < n) {
+        size_t racha = 1;
+        while (i + racha < n && racha < 128 && in[i + racha] == in[i]) racha++;
+        if (racha >= 3) {
+            out += (char)(257 - racha);
+            out += (char)in[i];
+            i += racha;
+            continue;
+        }
+        size_t j = i;
+        while (j < n && j - i < 128) {
+            if (j + 2 < n && in[j] == in[j + 1] && in[j] == in[j + 2]) break;
+            j++;
+        }
+        out += (char)(j - i - 1);
+        out.append((const char*)in + i, j - i);
+        i = j;
+    }
+}
+
+static bool unpackBits(const unsigned char* in, size_t n, unsigned char* out, size_t total) {
+    size_t o = 0;
+    const unsigned char* fin = in + n;
+    while (in < fin) {
+        int c = *in++;
+        if (c < 128) {
+            size_t len = c + 1;
+            if ((size_t)(fin - in) < len || o + len > total) return false;
+            memcpy(out + o, in, len);
+            in += len;
+            o += len;
+        } else if (c > 128) {
+            size_t len = 257 - c;
+            if (in == fin || o + len > total) return false;
+            memset(out + o, *in++, len);
+            o += len;
+        }
+    }
+    return o == total;
+}
+
+// comprimirTesela: residuos de v (ver tiled.h) y el registro de la tesela
+static void comprimirTesela(ConstImageView v, int bps, string& out) {
+    int muestras = v.width * v.channels;
+    size_t total = (size_t)muestras * v.height;
+    unsigned mask = bps == 1 ? 0xFF : 0xFFFF;
+    vector<unsigned char> planos(total * bps);
+    size_t i = 0;
+    for (int y = 0; y < v.height; y++) {
+        const int* fila = v.row(y);
+        for (int k = 0; k < muestras; k++, i++) {
+            int pred = k >= v.channels ? fila[k - v.channels] : (y > 0 ? v.row(y - 1)[k] : 0);
+            unsigned r = (unsigned)(fila[k] - pred) & mask;
+            if (bps == 1) {
+                planos[i] = (unsigned char)r;
+            } else {
+                planos[i] = (unsigned char)(r >> 8);
+                planos[total + i] = (unsigned char)r;
+            }
+        }
+    }
+    out.reserve(planos.size() + 1);
+    out.assign(1, (char)1);
+    packBits(planos.data(), planos.size(), out);
+    if (out.size() >= planos.size() + 1) {
+        out.assign(1, (char)0);
+        out.append((const char*)planos.data(), planos.size());
+    }
+}
+
+// descomprimirTesela: el registro rec de la tesela (tx, ty) a las filas y columnas de out
+// que caen dentro de ella; (ox, oy) es la posición en la imagen de la muestra (0, 0) de
+// out, y se llena también su borde de guarda
+static bool descomprimirTesela(const unsigned char* rec, size_t n, const TileContainer::Header& h,
+                               int tx, int ty, Image& out, int ox, int oy) {
+    int x0 = tx * h.tileW, y0 = ty * h.tileH;
+    int tw = min(h.tileW, h.width - x0), th = min(h.tileH, h.height - y0);
+    int ch = h.channels(), bps = h.maxColor < 256 ? 1 : 2;
+    int muestras = tw * ch;
+    size_t total = (size_t)muestras * th;
+    // Lo mismo que en leerCabecera para el registro de esta tesela sola
+    if (n < 1 || total * bps > (n - 1) * 64) return false;
+    vector<unsigned char> planos(total * bps);
+    if (rec[0] == 0) {
+        if (n - 1 != planos.size()) return false;
+        memcpy(planos.data(), rec + 1, planos.size());
+    } else if (rec[0] != 1 || !unpackBits(rec + 1, n - 1, planos.data(), planos.size())) {
+        return false;
+    }
+
+    vector<int> tesela(total);
+    unsigned mask = bps == 1 ? 0xFF : 0xFFFF;
+    size_t i = 0;
+    for (int y = 0; y < th; y++) {
+        for (int k = 0; k < muestras; k++, i++) {
+            int pred = k >= ch ? tesela[i - ch] : (y > 0 ? tesela[i - muestras] : 0);
+            unsigned r = bps == 1 ? planos[i] : ((unsigned)planos[i] << 8) | planos[total + i];
+            tesela[i] = (int)((pred + r) & mask);
+        }
+    }
+
+    // Intersección de la tesela con out más su borde, en coordenadas de la imagen
+    int cx0 = max(x0, ox - out.border), cx1 = min(x0 + tw, ox + out.width + out.border);
+    int cy0 = max(y0, oy - out.border), cy1 = min(y0 + th, oy + out.height + out.border);
+    if (cx0 >= cx1) return true;
+    for (int y = cy0; y < cy1; y++) {
+        const int* src = &tesela[(size_t)(y - y0) * muestras + (size_t)(cx0 - x0) * ch];
+        copy(src, src + (size_t)(cx1 - cx0) * ch, out.row(y - oy) + (ptrdiff_t)(cx0 - ox) * ch);
+    }
+    return true;
+}
+
+void TileContainer::encode(const Image& img, string& out, int tile) {
+    if (tile <= 0) {
+        const char* env = getenv("FILTER_TILE_SIZE");
+        tile = (env && atoi(env) > 0) ? atoi(env) : 256;
+    }
+    Header h = {img.magic, img.width, img.height, img.maxColor, tile, tile};
+    int bps = img.maxColor < 256 ? 1 : 2;
+    vector<string> registros(h.tiles());
+    ConstImageView v = img.view();
+    paraCada(h.tiles(), [&](size_t i) {
+        int tx = (int)(i % h.tilesX()), ty = (int)(i / h.tilesX());
+        int x0 = tx * h.tileW, y0 = ty * h.tileH;
+        comprimirTesela(v.sub(x0, y0, min(h.tileW, h.width - x0), min(h.tileH, h.height - y0)), bps,
+                        registros[i]);
+    });
+
+    out.assign(h.bytes(), '\0');
+    unsigned char* p = (unsigned char*)&out[0];
+    memcpy(p, "PTL1", 4);
+    memcpy(p + 4, h.magic.data(), 2);
+    ponerU(p + 8, h.width, 4);
+    ponerU(p + 12, h.height, 4);
+    ponerU(p + 16, h.maxColor, 4);
+    ponerU(p + 20, h.tileW, 4);
+    ponerU(p + 24, h.tileH, 4);
+    size_t total = h.bytes();
+    for (size_t i = 0; i < registros.size(); i++) total += registros[i].size();
+    out.reserve(total);
+    MemoryStats::instance().add(MEM_FILE, (long long)out.capacity());
+    for (size_t i = 0; i <= registros.size(); i++) {
+        ponerU((unsigned char*)&out[28 + 8 * i], out.size(), 8);
+        if (i < registros.size()) {
+            out += registros[i];
+            string().swap(registros[i]);
+        }
+    }
+}
+
+bool TileContainer::decode(const string& data, const string& name, Image& img, int guard) {
+    Header h;
+    const unsigned char* base = (const unsigned char*)data.data();
+    vector<unsigned long long> index;
+    if (!leerCabecera(base, data.size(), data.size(), h) || !leerIndice(base + 28, h, data.size(), index)) {
+        cerr << "Contenedor por teselas inválido: " << name << "\n";
+        return false;
+    }
+    if (!img.allocate(h.magic, h.width, h.height, h.maxColor, guard)) {
+        cerr << "Dimensiones no soportadas: " << name << " (" << h.width << "x" << h.height << ")\n";
+        return false;
+    }
+    MemoryStats::instance().add(MEM_INPUT, vectorBytes(img.pixels));
+    atomic<bool> ok(true);
+    paraCada(h.tiles(), [&](size_t i) {
+        if (!descomprimirTesela(base + index[i], index[i + 1] - index[i], h, (int)(i % h.tilesX()),
+                                (int)(i / h.tilesX()), img, 0, 0)) {
+            ok = false;
+        }
+    });
+    if (!ok) cerr << "Tesela dañada en " << name << "\n";
+    return ok;
+}
+
+bool TileContainer::open(const string& p) {
+    close();
+    path = p;
+    fd = ::open(p.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    unsigned char cab[28];
+    off_t tam = lseek(fd, 0, SEEK_END);
+    if (tam < 0 || pread(fd, cab, 28, 0) != 28 || !leerCabecera(cab, 28, (size_t)tam, hdr)) {
+        close();
+        return false;
+    }
+    vector<unsigned char> crudo(hdr.bytes() - 28);
+    if (pread(fd, crudo.data(), crudo.size(), 28) != (ssize_t)crudo.size() ||
+        !leerIndice(crudo.data(), hdr, (size_t)tam, index)) {
+        close();
+        return false;
+    }
+    tilesRead = 0;
+    bytesRead = (long long)hdr.bytes();
+    return true;
+}
+
+void TileContainer::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+bool TileContainer::readRegion(int x, int y, int w, int h, int halo, Image& out) {
+    if (fd < 0 || x < 0 || y < 0 || w <= 0 || h <= 0 || (long long)x + w > hdr.width ||
+        (long long)y + h > hdr.height) {
+        return false;
+    }
+    if (!out.allocate(hdr.magic, w, h, hdr.maxColor, halo)) return false;
+    MemoryStats::instance().add(MEM_INPUT, vectorBytes(out.pixels));
+    // Teselas que tocan el rectángulo con su halo, recortado a la imagen
+    long long finX = min((long long)hdr.width, (long long)x + w + halo);
+    long long finY = min((long long)hdr.height, (long long)y + h + halo);
+    int tx0 = max(0, x - halo) / hdr.tileW, tx1 = (int)((finX - 1) / hdr.tileW);
+    int ty0 = max(0, y - halo) / hdr.tileH, ty1 = (int)((finY - 1) / hdr.tileH);
+    size_t ancho = tx1 - tx0 + 1;
+    atomic<bool> ok(true);
+    paraCada(ancho * (ty1 - ty0 + 1), [&](size_t i) {
+        int tx = tx0 + (int)(i % ancho), ty = ty0 + (int)(i / ancho);
+        size_t t = (size_t)ty * hdr.tilesX() + tx;
+        size_t n = index[t + 1] - index[t];
+        vector<unsigned char> rec(n);
+        if (pread(fd, rec.data(), n, (off_t)index[t]) != (ssize_t)n ||
+            !descomprimirTesela(rec.data(), n, hdr, tx, ty, out, x, y)) {
+            ok = false;
+            return;
+        }
+        tilesRead++;
+        bytesRead += (long long)n;
+    });
+    if (!ok) cerr << "Error leyendo teselas de " << path << "\n";
+    return ok;
+}
@@ -0,0 +1,91 @@
+#ifndef TILED_H
+#define TILED_H
+
+// tiled.h: contenedor propio por teselas (.ptl). PNM sólo se puede leer de principio a fin;
+// acá la imagen se parte en teselas de tamaño fijo comprimidas por separado, con un índice
+// al principio, así que se puede leer sólo un rectángulo (más su halo) y cada tesela se
+// descomprime en paralelo. Image::load/save lo reconocen solos (ver image.cpp) y pnmtile
+// convierte desde y hacia P2/P3/P5/P6.
+//
+// Formato (enteros little-endian):
+//   "PTL1"                  4 bytes
+//   tipo PNM original       2 bytes (P2, P3, P5 o P6; se conserva al volver a PNM)
+//   reservado               2 bytes en cero
+//   ancho, alto, maxColor   uint32 cada uno
+//   tileW, tileH            uint32: tamaño de las teselas (las del borde pueden ser menores)
+//   índice                  (teselas + 1) uint64: desplazamiento desde el inicio del archivo
+//                           de cada tesela, en orden de filas; la última entrada es el final
+//   teselas                 un byte de método y los datos:
+//                             0  residuos sin comprimir
+//                             1  residuos comprimidos con PackBits (RLE por bytes)
+// Residuos: cada muestra menos la del píxel de la izquierda del mismo canal (la primera de
+// cada fila, menos la primera de la fila de arriba), módulo 2^8 o 2^16 según maxColor.
+// Con 2 bytes por muestra van primero todos los bytes altos y después los bajos, así las
+// rachas de bytes altos iguales se comprimen bien. En degradados y zonas planas los
+// residuos se repiten; en ruido la tesela queda sin comprimir y sólo cuesta un byte más.
+//
+// Hilos: FILTER_TILE_THREADS (por defecto los del procesador) para comprimir y leer.
+// Tamaño de tesela al guardar: FILTER_TILE_SIZE (por defecto 256).
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "image.h"
+
+class TileContainer {
+public:
+    struct Header {
+        std::string magic;
+        int width, height, maxColor;
+        int tileW, tileH;
+
+        int tilesX() const { return (int)(((long long)width + tileW - 1) / tileW); }
+        int tilesY() const { return (int)(((long long)height + tileH - 1) / tileH); }
+        // tiles: en size_t; leerCabecera (tiled.cpp) rechaza las cabeceras en las que no
+        // entra, ni el índice que sigue, en el tamaño del archivo
+        size_t tiles() const { return (size_t)tilesX() * tilesY(); }
+        int channels() const { return (magic == "P3" || magic == "P6") ? 3 : 1; }
+        // bytes: cabecera fija más el índice
+        size_t bytes() const { return 28 + 8 * (tiles() + 1); }
+    };
+
+    // isTiled: el contenido (o su comienzo) es un contenedor .ptl
+    static bool isTiled(const std::string& data) { return data.compare(0, 4, "PTL1") == 0; }
+
+    // encode: el contenido del archivo .ptl de img, con teselas de tile x tile (0: el valor
+    // de FILTER_TILE_SIZE)
+    static void encode(const Image& img, std::string& out, int tile = 0);
+
+    // decode: toda la imagen desde el contenido de un .ptl (lo que hace Image::parse)
+    static bool decode(const std::string& data, const std::string& name, Image& img, int guard = 0);
+
+    TileContainer() : fd(-1), tilesRead(0), bytesRead(0) {}
+    ~TileContainer() { close(); }
+
+    // open: lee la cabecera y el índice; las teselas se leen después, a pedido
+    bool open(const std::string& path);
+    void close();
+    const Header& header() const { return hdr; }
+
+    // readRegion: out pasa a ser el rectángulo [x, x + w) x [y, y + h) con un borde de halo
+    // píxeles (Image::border) que tiene los vecinos reales de la imagen, o ceros fuera de
+    // ella: lo que una convolución de radio <= halo necesita. Sólo se leen las teselas que
+    // tocan el rectángulo más el halo. Se puede llamar desde varios hilos a la vez
+    bool readRegion(int x, int y, int w, int h, int halo, Image& out);
+
+    // Teselas y bytes leídos del archivo desde open
+    long long getTilesRead() const { return tilesRead; }
+    long long getBytesRead() const { return bytesRead; }
+
+private:
+    Header hdr;
+    std::vector<unsigned long long> index;
+    std::string path;
+    int fd;
+    std::atomic<long long> tilesRead, bytesRead;
+
+    TileContainer(const TileContainer&);
+    TileContainer& operator=(const TileContainer&);
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+// timing.h: medición por fases común a los cuatro backends (serial, OpenMP, pthreads, MPI).
+// Cada backend registra las mismas fases en nanosegundos y, si la variable de entorno
+// FILTER_TIMING_JSON está definida, agrega una línea JSON por ejecución a ese archivo
+// ("-" para imprimirla en la salida estándar). La línea incluye además los bytes
+// reservados por categoría de búfer, el pico de RSS del proceso (memory.h) y cuántos
+// bloques de píxeles salieron reutilizados del pool (pool.h).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "memory.h"
+#include "pool.h"
+#include "trace.h"
+
+// Fases que se miden: leer el archivo, convertir el texto a píxeles, calcular el filtro,
+// repartir datos entre procesos, recolectar resultados y escribir la salida
+enum Phase { PHASE_LOAD, PHASE_PARSE, PHASE_COMPUTE, PHASE_COMM, PHASE_GATHER, PHASE_SAVE, NUM_PHASES };
+
+inline const char* phaseName(int p) {
+    static const char* names[NUM_PHASES] = {"load", "parse", "compute", "communication", "gather", "save"};
+    return names[p];
+}
+
+class PhaseTimer {
+    std::string backend;
+    std::string filter;
+    int workers;
+    long long ns[NUM_PHASES];
+    long long startNs;
+    std::vector<std::pair<std::string, std::vector<long long> > > extras;
+    std::vector<std::pair<std::string, double> > metrics;
+public:
+    PhaseTimer(const std::string& b, int w = 1) : backend(b), workers(w), startNs(nowNs()) {
+        for (int p = 0; p < NUM_PHASES; p++) ns[p] = 0;
+    }
+
+    void setFilter(const std::string& f) { filter = f; }
+    void setWorkers(int w) { workers = w; }
+    void add(Phase p, long long elapsedNs) { ns[p] += elapsedNs; }
+    long long get(Phase p) const { return ns[p]; }
+    void set(Phase p, long long value) { ns[p] = value; }
+
+    // addExtra: serie adicional que se incluye tal cual en el JSON (por ejemplo, el
+    // tiempo de cómputo de cada rank para ver el desbalance)
+    void addExtra(const std::string& key, const std::vector<long long>& values) {
+        extras.push_back(std::make_pair(key, values));
+    }
+
+    // addMetric: valor derivado (contadores de hardware, IPC, ...) que va en "metrics"
+    void addMetric(const std::string& key, double value) {
+        metrics.push_back(std::make_pair(key, value));
+    }
+
+    // wallNs: tiempo de pared desde que se creó el cronómetro
+    long long wallNs() const { return nowNs() - startNs; }
+
+    // Scope: mide el tiempo de vida del bloque, lo suma a la fase indicada y, si la
+    // traza está activa, lo agrega a la línea de tiempo
+    class Scope {
+        PhaseTimer* timer;
+        Phase phase;
+        long long begin;
+    public:
+        Scope(PhaseTimer* t, Phase p) : timer(t), phase(p), begin(nowNs()) {}
+        ~Scope() {
+            long long end = nowNs();
+            if (timer) timer->add(phase, end - begin);
+            Tracer::instance().record(phaseName(phase), "phase", begin, end);
+        }
+    };
+
+    std::string json() const {
+        std::ostringstream out;
+        out << "{\"backend\":\"" << backend << "\",\"filter\":\"" << filter << "\",\"workers\":" << workers
+            << ",\"phases_ns\":{";
+        for (int p = 0; p < NUM_PHASES; p++) {
+            if (p > 0) out << ",";
+            out << "\"" << phaseName(p) << "\":" << ns[p];
+        }
+        out << "},\"wall_ns\":" << wallNs();
+        const MemoryStats& mem = MemoryStats::instance();
+        out << ",\"memory_bytes\":{";
+        for (int c = 0; c < NUM_MEM_CATEGORIES; c++) {
+            out << "\"" << memCategoryName(c) << "\":" << mem.get((MemCategory)c) << ",";
+        }
+        out << "\"total\":" << mem.total() << "},\"peak_rss_bytes\":" << peakRssBytes();
+        const PixelPool& pool = PixelPool::instance();
+        out << ",\"pool\":{\"requests\":" << pool.getRequests() << ",\"reused\":" << pool.getReused()
+            << ",\"cached_bytes\":" << pool.getCachedBytes() << "}";
+        for (size_t i = 0; i < extras.size(); i++) {
+            out << ",\"" << extras[i].first << "\":[";
+            for (size_t k = 0; k < extras[i].second.size(); k++) {
+                if (k > 0) out << ",";
+                out << extras[i].second[k];
+            }
+            out << "]";
+        }
+        if (!metrics.empty()) {
+            out.precision(12);
+            out << ",\"metrics\":{";
+            for (size_t i = 0; i < metrics.size(); i++) {
+                if (i > 0) out << ",";
+                out << "\"" << metrics[i].first << "\":" << metrics[i].second;
+            }
+            out << "}";
+        }
+        out << "}";
+        return out.str();
+    }
+
+    // report: escribe la línea JSON si FILTER_TIMING_JSON está definida
+    void report() const {
+        const char* path = std::getenv("FILTER_TIMING_JSON");
+        if (path == NULL || *path == '\0') return;
+        std::string line = json();
+        if (std::string(path) == "-") {
+            std::cout << line << std::endl;
+            return;
+        }
+        std::ofstream out(path, std::ios::app);
+        if (!out.is_open()) {
+            std::cerr << "Error abriendo archivo de tiempos: " << path << "\n";
+            return;
+        }
+        out << line << "\n";
+    }
+};
+
+// readFile: lee el archivo completo a memoria; se mide como la fase load
+inline bool readFile(const std::string& filename, std::string& data, PhaseTimer* timer = NULL) {
+    PhaseTimer::Scope scope(timer, PHASE_LOAD);
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in.is_open()) return false;
+    in.seekg(0, std::ios::end);
+    std::streamoff size = in.tellg();
+    in.seekg(0, std::ios::beg);
+    data.resize(size > 0 ? (size_t)size : 0);
+    if (size > 0) in.read(&data[0], size);
+    MemoryStats::instance().add(MEM_FILE, (long long)data.capacity());
+    return true;
+}
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// trace.h: línea de tiempo opcional en formato Chrome trace-event (se abre en
+// chrome://tracing o en ui.perfetto.dev). Se activa con FILTER_TRACE=archivo.json.
+// Cada hilo registra intervalos (fases, filtros, cuadrantes, bloques) en un buffer
+// preasignado: reservar un lugar es un fetch_add atómico, sin locks ni memoria nueva
+// mientras corre el filtro. Si el buffer se llena (FILTER_TRACE_EVENTS, por defecto 65536)
+// los eventos sobrantes se descartan y se cuentan.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// nowNs: reloj monótono en nanosegundos (compartido por procesos de la misma máquina)
+inline long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TraceEvent {
+    const char* name;   // literales: no se copian cadenas al registrar
+    const char* cat;
+    long long startNs;
+    long long durNs;
+    int tid;
+    long long arg;      // índice de bloque o cuadrante; -1 si no aplica
+};
+
+class Tracer {
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> next;
+    std::atomic<size_t> dropped;
+    std::atomic<int> nextTid;
+    std::string path;
+    int pid;
+
+    Tracer() : next(0), dropped(0), nextTid(0), pid(0) {
+        const char* p = std::getenv("FILTER_TRACE");
+        if (p == NULL || *p == '\0') return;
+        path = p;
+        const char* cap = std::getenv("FILTER_TRACE_EVENTS");
+        long n = cap ? std::atol(cap) : 0;
+        events.resize(n > 0 ? (size_t)n : 65536);
+    }
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    bool enabled() const { return !path.empty(); }
+    const std::string& outputPath() const { return path; }
+
+    // setPid: en MPI cada rank es un proceso distinto en la línea de tiempo
+    void setPid(int p) { pid = p; }
+
+    // threadId: identificador pequeño y estable por hilo, en orden de primer uso
+    int threadId() {
+        thread_local int id = -1;
+        if (id < 0) id = nextTid.fetch_add(1);
+        return id;
+    }
+
+    void record(const char* name, const char* cat, long long startNs, long long endNs, long long arg = -1) {
+        if (!enabled()) return;
+        size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= events.size()) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        TraceEvent& e = events[slot];
+        e.name = name;
+        e.cat = cat;
+        e.startNs = startNs;
+        e.durNs = endNs - startNs;
+        e.tid = threadId();
+        e.arg = arg;
+    }
+
+    // eventsJson: eventos de este proceso separados por comas, sin los corchetes, para
+    // poder juntar los de varios ranks en un solo archivo
+    std::string eventsJson() const {
+        std::ostringstream out;
+        size_t n = next.load();
+        if (n > events.size()) n = events.size();
+        out.setf(std::ios::fixed);
+        out.precision(3);
+        for (size_t i = 0; i < n; i++) {
+            const TraceEvent& e = events[i];
+            if (i > 0) out << ",\n";
+            out << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.cat << "\",\"ph\":\"X\",\"ts\":"
+                << e.startNs / 1000.0 << ",\"dur\":" << e.durNs / 1000.0 << ",\"pid\":" << pid
+                << ",\"tid\":" << e.tid;
+            if (e.arg >= 0) out << ",\"args\":{\"index\":" << e.arg << "}";
+            out << "}";
+        }
+        if (dropped.load() > 0) {
+            std::cerr << "Traza: " << dropped.load() << " eventos descartados, aumentar FILTER_TRACE_EVENTS\n";
+        }
+        return out.str();
+    }
+
+    static void writeFile(const std::string& path, const std::string& body) {
+        std::ofstream out(path.c_str());
+        if (!out.is_open()) {
+            std::cerr << "Error guardando traza: " << path << "\n";
+            return;
+        }
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" << body << "\n]}\n";
+    }
+
+    // dump: escribe la traza de este proceso si está activada
+    void dump() const {
+        if (enabled()) writeFile(path, eventsJson());
+    }
+};
+
+// TraceScope: registra el intervalo que dura el bloque
+class TraceScope {
+    const char* name;
+    const char* cat;
+    long long arg;
+    long long begin;
+public:
+    TraceScope(const char* n, const char* c, long long a = -1)
+        : name(n), cat(c), arg(a), begin(Tracer::instance().enabled() ? nowNs() : 0) {}
+    ~TraceScope() {
+        if (Tracer::instance().enabled()) Tracer::instance().record(name, cat, begin, nowNs(), arg);
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+// writer.h: escritura asíncrona de imágenes. Un hilo de E/S dedicado recibe las imágenes
+// terminadas, las codifica (Image::save, que en ASCII es lo más lento) y las escribe,
+// mientras los hilos de cómputo siguen con el filtro siguiente. guardar() toma la imagen
+// (se mueve, no se copia) y devuelve un future que se cumple cuando el archivo quedó
+// escrito; el tiempo se suma a la fase save del PhaseTimer indicado desde el hilo de E/S,
+// así que hay que esperar el future antes de leer ese PhaseTimer.
+// FILTER_ASYNC_WRITE=0 escribe en el hilo que llama, como antes, para comparar.
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "image.h"
+
+class AsyncWriter {
+    struct Pedido {
+        Image img;
+        std::string path;
+        PhaseTimer* timer;
+        std::promise<bool> hecho;
+    };
+
+    std::mutex mtx;
+    std::condition_variable hayTrabajo;
+    std::deque<Pedido> cola;
+    bool cerrar;
+    bool asincrono;
+    std::thread hilo;
+
+    AsyncWriter() : cerrar(false) {
+        const char* env = std::getenv("FILTER_ASYNC_WRITE");
+        asincrono = !(env && std::string(env) == "0");
+        if (asincrono) hilo = std::thread(&AsyncWriter::ciclo, this);
+    }
+
+    static bool escribir(Pedido& p) {
+        PhaseTimer::Scope scope(p.timer, PHASE_SAVE);
+        return p.img.save(p.path);
+    }
+
+    // ciclo: el hilo de E/S atiende los pedidos en orden de llegada hasta que lo cierran
+    // y la cola queda vacía
+    void ciclo() {
+        for (;;) {
+            Pedido p;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                hayTrabajo.wait(lock, [this] { return cerrar || !cola.empty(); });
+                if (cola.empty()) return;
+                p = std::move(cola.front());
+                cola.pop_front();
+            }
+            bool ok = escribir(p);
+            // Los píxeles vuelven al pool antes de avisar que terminó
+            p.img.pixels = PixelBuffer();
+            p.hecho.set_value(ok);
+        }
+    }
+
+public:
+    static AsyncWriter& instance() {
+        static AsyncWriter writer;
+        return writer;
+    }
+
+    ~AsyncWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            cerrar = true;
+        }
+        hayTrabajo.notify_one();
+        if (hilo.joinable()) hilo.join();
+    }
+
+    // guardar: encola la imagen para escribirla en path; el future vale lo que devuelva
+    // Image::save
+    std::future<bool> guardar(Image&& img, const std::string& path, PhaseTimer* timer = NULL) {
+        Pedido p;
+        p.img = std::move(img);
+        p.path = path;
+        p.timer = timer;
+        std::future<bool> resultado = p.hecho.get_future();
+        if (!asincrono) {
+            p.hecho.set_value(escribir(p));
+            return resultado;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            cola.push_back(std::move(p));
+        }
+        hayTrabajo.notify_one();
+        return resultado;
+    }
+};
+
+#endif